@@ -9,12 +9,20 @@
 #ifndef EASYLAZY_HPP_INCLUDED
 #define EASYLAZY_HPP_INCLUDED
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <tuple>
 #include <type_traits>
@@ -24,21 +32,501 @@
 #ifdef EASYLAZY_ENABLE_INTEGER
 #include <boost/multiprecision/cpp_int.hpp>
 #endif
+#ifndef EASYLAZY_DISABLE_SIMD
+#if defined(__AVX2__)
+#define EASYLAZY_DETAIL_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EASYLAZY_DETAIL_SSE2
+#endif
+#endif
+#if defined(EASYLAZY_DETAIL_AVX2)
+#include <immintrin.h>
+#elif defined(EASYLAZY_DETAIL_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef EASYLAZY_ENABLE_PERSISTENCE
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <typeinfo>
+#include <unordered_map>
+#if defined(__unix__) || defined(__APPLE__)
+#define EASYLAZY_DETAIL_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
 
 namespace easylazy {
 
+// Budget
+enum class suspension {
+    steps_exhausted,
+    deadline_passed,
+    cancelled
+};
+
+class cancellation_token {
+    std::shared_ptr<std::atomic<bool>> flag;
+
+public:
+    cancellation_token() :
+        flag(std::make_shared<std::atomic<bool>>(false)) {
+    }
+
+    void cancel() const noexcept {
+        flag->store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const noexcept {
+        return flag->load(std::memory_order_relaxed);
+    }
+};
+
+struct budget {
+    std::size_t steps = std::numeric_limits<std::size_t>::max();
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::optional<cancellation_token> token;
+};
+
+namespace detail {
+
+struct suspended {
+    suspension reason;
+};
+
+class budget_state {
+    budget b;
+    std::size_t entries = 0;
+
+public:
+    explicit budget_state(budget b_) :
+        b(std::move(b_)) {
+    }
+
+    // Called on entering a thunk yet to be resolved.
+    void enter() {
+        if (b.token && b.token->cancelled()) {
+            throw suspended{suspension::cancelled};
+        } else if (b.steps == 0) {
+            throw suspended{suspension::steps_exhausted};
+        }
+        // Reading the clock costs more than resolving a small thunk.
+        if (
+            b.deadline != std::chrono::steady_clock::time_point::max() &&
+            entries++ % 256 == 0 &&
+            std::chrono::steady_clock::now() >= b.deadline
+        ) {
+            throw suspended{suspension::deadline_passed};
+        }
+    }
+
+    // Called when a computation has returned. Only finished computations consume steps,
+    // so that each call of `try_get` makes progress however deep the pending ones are,
+    // provided that no single computation needs more of them than the budget.
+    // The computations nested in this one may have spent the last step.
+    void leave() {
+        if (b.steps != 0) {
+            --b.steps;
+        }
+    }
+};
+
+inline budget_state *&current_budget() {
+    static thread_local budget_state *b = nullptr;
+    return b;
+}
+
+} // namespace detail {
+
+// Dependency tracking
+namespace detail {
+
+// The part of a thunk which reads a cell, directly or not, to be recomputed when the cell is set.
+class dependency {
+    // Thunks which have read this one, with their generations at that time.
+    std::vector<std::pair<std::weak_ptr<dependency>, std::size_t>> dependents;
+    std::size_t pruned_size = 16;
+
+protected:
+    // Incremented whenever the thunk forgets its value, which makes the edges to it stale.
+    std::size_t generation = 0;
+
+    // Thunks read by this one, kept alive so that the edges from them to this one hold.
+    std::vector<std::shared_ptr<dependency>> sources;
+
+    ~dependency() = default;
+
+    // Forgets the value, to be recomputed on demand.
+    virtual void reset() = 0;
+
+public:
+    std::size_t version() const {
+        return generation;
+    }
+
+    void add_source(std::shared_ptr<dependency> const &d, std::weak_ptr<dependency> self) {
+        d->dependents.emplace_back(std::move(self), generation);
+        if (d->dependents.size() >= d->pruned_size) {
+            d->prune();
+        }
+        sources.push_back(d);
+    }
+
+    // Resets the thunks which have read this one, and those which have read them, and so on.
+    void invalidate() {
+        std::vector<std::shared_ptr<dependency>> work;
+        take_dependents(work);
+        while (!work.empty()) {
+            auto d = std::move(work.back());
+            work.pop_back();
+            d->reset();
+            d->take_dependents(work);
+        }
+    }
+
+private:
+    void take_dependents(std::vector<std::shared_ptr<dependency>> &work) {
+        for (auto &[w, g] : dependents) {
+            if (auto d = w.lock(); d && d->generation == g) {
+                work.push_back(std::move(d));
+            }
+        }
+        dependents.clear();
+        pruned_size = 16;
+    }
+
+    // Drops the edges to thunks destroyed or reset since, which accumulate while nothing is set.
+    void prune() {
+        dependents.erase(
+            std::remove_if(dependents.begin(), dependents.end(), [](auto const &e) {
+                auto d = e.first.lock();
+                return !d || d->generation != e.second;
+            }),
+            dependents.end()
+        );
+        pruned_size = std::max<std::size_t>(16, dependents.size() * 2);
+    }
+};
+
+// Collects the tracked thunks read while a thunk is being resolved.
+class read_frame {
+    std::vector<std::shared_ptr<dependency>> reads;
+    read_frame *outer;
+
+    static read_frame *&current() {
+        static thread_local read_frame *f = nullptr;
+        return f;
+    }
+
+    static std::atomic<bool> &flag() {
+        static std::atomic<bool> b(false);
+        return b;
+    }
+
+public:
+    read_frame() :
+        outer(std::exchange(current(), this)) {
+    }
+
+    read_frame(read_frame const &) = delete;
+    read_frame &operator=(read_frame const &) = delete;
+
+    ~read_frame() {
+        current() = outer;
+    }
+
+    // Frames are not pushed until the first cell is constructed, which keeps the cost of tracking
+    // away from programs without cells.
+    static bool enabled() {
+        return flag().load(std::memory_order_relaxed);
+    }
+
+    static void enable() {
+        flag().store(true, std::memory_order_relaxed);
+    }
+
+    static bool active() {
+        return current() != nullptr;
+    }
+
+    // Whether the thunk being resolved has read a tracked thunk so far.
+    static bool dirty() {
+        auto f = current();
+        return f && !f->reads.empty();
+    }
+
+    static void record(std::shared_ptr<dependency> d) {
+        if (auto f = current()) {
+            f->reads.push_back(std::move(d));
+        }
+    }
+
+    // The tracked thunks the thunk being resolved has read so far.
+    static std::vector<std::shared_ptr<dependency>> reads_so_far() {
+        auto f = current();
+        return f ? f->reads : std::vector<std::shared_ptr<dependency>>();
+    }
+
+    bool empty() const {
+        return reads.empty();
+    }
+
+    // Adds the edges from the thunks read so far to `self`.
+    void commit(dependency &d, std::weak_ptr<dependency> const &self) {
+        std::sort(reads.begin(), reads.end());
+        reads.erase(std::unique(reads.begin(), reads.end()), reads.end());
+        for (auto const &r : reads) {
+            d.add_source(r, self);
+        }
+        reads.clear();
+    }
+};
+
+// The tracked thunks a computation suspended by a budget has read, to be recorded again when
+// it resumes. They are kept with their generations, to see whether any has been reset since.
+class suspended_reads {
+    std::vector<std::pair<std::shared_ptr<dependency>, std::size_t>> reads;
+
+public:
+    void save() {
+        reads.clear();
+        for (auto &d : read_frame::reads_so_far()) {
+            auto g = d->version();
+            reads.emplace_back(std::move(d), g);
+        }
+    }
+
+    // Records the reads again, or returns false if what was computed from them is stale.
+    bool resume() const {
+        for (auto const &[d, g] : reads) {
+            if (d->version() != g) {
+                return false;
+            }
+        }
+        for (auto const &r : reads) {
+            read_frame::record(r.first);
+        }
+        return true;
+    }
+};
+
+} // namespace detail {
+
 // Thunk
 template <class T>
 class thunk;
 
 namespace detail {
 
+struct thunk_access;
+
 template <class T>
 class thunk_base {
-    using impl = std::variant<T, std::function<thunk<T> ()>>;
+    // A value, a computation, or the thunk returned by the computation, which is being resolved.
+    using state = std::variant<T, std::function<thunk<T> ()>, thunk<T>>;
+
+    // The state of a thunk which is a cell or has read one, kept aside with its edges.
+    struct tracked final :
+        dependency {
+        state s;
+        // What to resolve again when reset: the computation if it has read a tracked thunk,
+        // or else the tracked thunk it returned.
+        std::variant<std::monostate, std::function<thunk<T> ()>, thunk<T>> source;
+
+        explicit tracked(state s_) :
+            s(std::move(s_)) {
+        }
+
+        void reset() override {
+            ++generation;
+            sources.clear();
+            if (source.index() == 1) {
+                s.template emplace<1>(std::move(std::get<1>(source)));
+            } else if (source.index() == 2) {
+                s.template emplace<2>(std::move(std::get<2>(source)));
+            }
+            source.template emplace<0>();
+        }
+
+        void assign(state s_) {
+            reset();
+            s = std::move(s_);
+            invalidate();
+        }
+    };
+
+    // Most thunks are never tracked, and stay as small as the three states.
+    using impl = std::variant<T, std::function<thunk<T> ()>, thunk<T>, std::unique_ptr<tracked>>;
 
     std::shared_ptr<impl> pimpl;
 
+    friend struct thunk_access;
+
+    std::shared_ptr<dependency> as_dependency() const {
+        return std::shared_ptr<dependency>(pimpl, std::get<3>(*pimpl).get());
+    }
+
+    void track() const {
+        read_frame::enable();
+        if (pimpl->index() == 0) {
+            pimpl->template emplace<3>(
+                std::make_unique<tracked>(state(std::in_place_index<0>, std::move(std::get<0>(*pimpl))))
+            );
+        } else if (pimpl->index() == 1) {
+            pimpl->template emplace<3>(
+                std::make_unique<tracked>(state(std::in_place_index<1>, std::move(std::get<1>(*pimpl))))
+            );
+        }
+    }
+
+    T const &force() const {
+        auto &s = *pimpl;
+        if (s.index() == 0) {
+            return std::get<0>(s);
+        } else if (s.index() == 3 || read_frame::enabled()) {
+            return force_tracking();
+        } else if (auto b = current_budget()) {
+            b->enter();
+        }
+        if (s.index() == 1) {
+            // Release the computation, and everything it captured, before resolving its result.
+            auto x = std::get<1>(s)();
+            if (auto b = current_budget()) {
+                b->leave();
+            }
+            s.template emplace<2>(std::move(x));
+        }
+        if (s.index() == 2) {
+            T value = std::get<2>(s).take();
+            s.template emplace<0>(std::move(value));
+        }
+        return std::get<0>(s);
+    }
+
+    // Resolves the thunk, recording the tracked thunks it reads.
+    T const &force_tracking() const {
+        auto &s = *pimpl;
+        if (s.index() != 3) {
+            if (auto b = current_budget()) {
+                b->enter();
+            }
+            read_frame frame;
+            if (s.index() == 1) {
+                auto x = std::get<1>(s)();
+                if (auto b = current_budget()) {
+                    b->leave();
+                }
+                if (frame.empty()) {
+                    s.template emplace<2>(std::move(x));
+                } else {
+                    // It has read a cell, and runs again when the cell is set.
+                    auto d = std::make_unique<tracked>(state(std::in_place_index<2>, std::move(x)));
+                    d->source.template emplace<1>(std::move(std::get<1>(s)));
+                    s.template emplace<3>(std::move(d));
+                    frame.commit(*std::get<3>(s), as_dependency());
+                }
+            }
+            if (s.index() == 2) {
+                T value = std::get<2>(s).take();
+                if (frame.empty()) {
+                    s.template emplace<0>(std::move(value));
+                } else {
+                    // The thunk it returned has read a cell, and is resolved again when the cell is set.
+                    auto d = std::make_unique<tracked>(state(std::in_place_index<0>, std::move(value)));
+                    d->source = std::get<2>(s);
+                    s.template emplace<3>(std::move(d));
+                    frame.commit(*std::get<3>(s), as_dependency());
+                }
+            }
+            if (s.index() == 0) {
+                return std::get<0>(s);
+            }
+        }
+        auto &d = *std::get<3>(s);
+        if (d.s.index() != 0) {
+            if (auto b = current_budget()) {
+                b->enter();
+            }
+            read_frame frame;
+            if (d.s.index() == 1) {
+                auto x = std::get<1>(d.s)();
+                if (auto b = current_budget()) {
+                    b->leave();
+                }
+                if (!frame.empty()) {
+                    d.source.template emplace<1>(std::move(std::get<1>(d.s)));
+                    frame.commit(d, as_dependency());
+                }
+                d.s.template emplace<2>(std::move(x));
+            }
+            if (d.s.index() == 2) {
+                T value = std::get<2>(d.s).take();
+                if (!frame.empty()) {
+                    if (d.source.index() == 0) {
+                        d.source = std::get<2>(d.s);
+                    }
+                    frame.commit(d, as_dependency());
+                }
+                d.s.template emplace<0>(std::move(value));
+            }
+        }
+        read_frame::record(as_dependency());
+        return std::get<0>(d.s);
+    }
+
+    // Resolves the thunk and returns its value, which is moved out if no other thunk shares it
+    // and no cell is involved. A computation which has read a cell may run again with what
+    // it captured, so nothing is moved out while tracking.
+    T take() const {
+        auto const &value = force();
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return value;
+        } else if (pimpl.use_count() != 1 || pimpl->index() != 0 || read_frame::active()) {
+            return value;
+        } else {
+// GCC 12 warns falsely on moving a std::variant out of another.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+            T moved = std::move(std::get<0>(*pimpl));
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+            pimpl->template emplace<1>([]() -> thunk<T> {
+                throw std::logic_error("thunk: value moved out");
+            });
+            return moved;
+        }
+    }
+
+    // Whether the thunk has its value, which it returns without running anything.
+    bool resolved() const {
+        return pimpl->index() == 0 || (pimpl->index() == 3 && std::get<3>(*pimpl)->s.index() == 0);
+    }
+
+    // Puts back a value moved out by `take`, for a computation which failed with it.
+    void restore(T value) const {
+        if (pimpl->index() == 1) {
+            pimpl->template emplace<0>(std::move(value));
+        }
+    }
+
+    void assign(state s) const {
+        if (read_frame::active()) {
+            throw std::logic_error("cell: set while resolving a thunk");
+        }
+        std::get<3>(*pimpl)->assign(std::move(s));
+    }
+
 public:
     using type = T;
 
@@ -104,11 +592,7 @@ public:
     }
 
     T get() const {
-        if (pimpl->index() == 0) {
-            return std::get<0>(*pimpl);
-        } else {
-            return pimpl->template emplace<0>(std::get<1>(*pimpl)().get());
-        }
+        return force();
     }
 
     explicit operator bool() const {
@@ -116,6 +600,48 @@ public:
     }
 };
 
+struct thunk_access {
+    template <class T>
+    static T const &force(thunk_base<T> const &x) {
+        return x.force();
+    }
+
+    template <class T>
+    static T take(thunk_base<T> const &x) {
+        return x.take();
+    }
+
+    // Lets the cells of a list that nothing else refers to go one by one, where letting them go
+    // recursively would overflow the stack on a long list.
+    template <class T>
+    static void release(thunk_base<T> &xs) {
+        auto p = std::move(xs.pimpl);
+        while (p.use_count() == 1 && p->index() == 0 && std::get<0>(*p).index() == 1) {
+            p = std::move(std::get<1>(std::get<1>(std::get<0>(*p))).pimpl);
+        }
+    }
+
+    template <class T>
+    static bool resolved(thunk_base<T> const &x) {
+        return x.resolved();
+    }
+
+    template <class T>
+    static void restore(thunk_base<T> const &x, T value) {
+        x.restore(std::move(value));
+    }
+
+    template <class T>
+    static void track(thunk_base<T> const &x) {
+        x.track();
+    }
+
+    template <class T, class ...Args>
+    static void assign(thunk_base<T> const &x, Args &&...args) {
+        x.assign(typename thunk_base<T>::state(std::forward<Args>(args)...));
+    }
+};
+
 } // namespace detail {
 
 template <class T>
@@ -171,7 +697,7 @@ public:
     R operator()(Args ...args) const {
         // Visual C++ 15.9.8 does not implement [*this] properly.
         return R([=, self = *this]() {
-            return self.get()(args...);
+            return detail::thunk_access::force(self)(args...);
         });
     }
 };
@@ -179,84 +705,282 @@ public:
 template <class Sig>
 using function = thunk<detail::function_rep<Sig>>;
 
-template <class T>
-class list_rep :
-    public std::variant<std::tuple<>, std::tuple<T, thunk<list_rep<T>>>> {
+// A function which keeps the type of its body, so that applying it is a direct call which can be
+// inlined. It converts to `function<Sig>`, which erases the type, to be stored. The body is shared,
+// so that what it has captured is not copied whenever the function is applied or passed on.
+template <class Sig, class F>
+class static_function;
+
+template <class R, class ...Args, class F>
+class static_function<R (Args...), F> {
+    std::shared_ptr<F const> f;
+
 public:
-    using std::variant<std::tuple<>, std::tuple<T, thunk<list_rep<T>>>>::variant;
+    explicit static_function(F f_) :
+        f(std::make_shared<F const>(std::move(f_))) {
+    }
+
+    R operator()(Args ...args) const {
+        return R([f = f, args...]() -> R {
+            return (*f)(args...);
+        });
+    }
+
+    operator function<R (Args...)>() const {
+        return function<R (Args...)>([f = f](Args ...args) -> R {
+            return (*f)(args...);
+        });
+    }
+};
+
+namespace detail {
+
+// The signature of `function<Sig>` or `static_function<Sig, F>`, which the list functions accept.
+template <class F>
+struct function_signature {};
+
+template <class Sig>
+struct function_signature<function<Sig>> {
+    using type = Sig;
+};
+
+template <class Sig, class F>
+struct function_signature<static_function<Sig, F>> {
+    using type = Sig;
+};
+
+template <class Sig>
+struct signature_result {};
+
+template <class R, class ...Args>
+struct signature_result<R (Args...)> {
+    using type = R;
 };
 
+template <class F>
+using function_result_t = typename signature_result<typename function_signature<F>::type>::type;
+
+// Makes a parameter not take part in template argument deduction.
 template <class T>
-class thunk<list_rep<T>> :
-    public detail::thunk_base<list_rep<T>> {
+struct identity {
+    using type = T;
+};
 
-    template <class Iterator, class Sentinel>
-    static thunk from_range(Iterator it, Sentinel end) {
-        if (it == end) {
-            return thunk(list_rep<T>(std::in_place_index<0>));
-        } else {
-            auto x = T(*it);
-            return thunk(list_rep<T>(std::in_place_index<1>, x, from_range(++it, end)));
-        }
+template <class T>
+using identity_t = typename identity<T>::type;
+
+} // namespace detail {
+
+// A value of a thunk of type `T`, resolved on construction. As a parameter type of a function,
+// it makes the argument resolved when the function is applied. It holds the value itself, and
+// makes a thunk only when converted to `T`.
+template <class T>
+class strict {
+    typename T::type value;
+
+public:
+    using type = typename T::type;
+
+    strict(T x) :
+        value(detail::thunk_access::take(x)) {
     }
 
-    template <class U>
-    std::vector<U> to_reversed_vector() const {
-        if (auto rep = this->get(); rep.index() == 0) {
-            return std::vector<U>();
-        } else {
-            auto [x, xs] = std::get<1>(rep);
-            auto rv = xs.template to_reversed_vector<U>();
-            rv.push_back(x.template get_as<U>());
-            return rv;
-        }
+    strict(type x) :
+        value(std::move(x)) {
     }
 
-    T at(int n) const {
-        if (n < 0) {
-            throw std::out_of_range("operator[]: negative index");
-        } else if (auto rep = this->get(); rep.index() == 0) {
-            throw std::out_of_range("operator[]: index too large");
-        } else if (auto [x, xs] = std::get<1>(rep); n == 0) {
-            return x;
-        } else {
-            return xs.at(n - 1);
-        }
+    type const &get() const {
+        return value;
+    }
+
+    operator T() const {
+        return T(value);
     }
+};
 
+// A thunk which can be set to another value. The thunks which have read it, directly or not,
+// are computed again when next resolved.
+template <class T>
+class cell :
+    public T {
 public:
-    using detail::thunk_base<list_rep<T>>::thunk_base;
+    explicit cell(typename T::type x) :
+        T(std::move(x)) {
+        detail::thunk_access::track(*this);
+    }
 
-    // In Clang, thunk_base(U &&) and thunk_base(F &&) are hidden by thunk(Range &&).
-    template <
-        class U,
-        std::enable_if_t<
-            std::conjunction_v<
-                std::negation<std::is_same<std::decay_t<U>, thunk>>,
-                std::is_constructible<list_rep<T>, U>
-            >
-        > * = nullptr
-    >
-    explicit thunk(U &&u) :
-        detail::thunk_base<list_rep<T>>(std::forward<U>(u)) {
+    explicit cell(T x) :
+        T([x]() {
+            return x;
+        }) {
+        detail::thunk_access::track(*this);
     }
 
-    template <
-        class F,
-        std::enable_if_t<
-            std::conjunction_v<
-                std::negation<std::is_same<std::decay_t<F>, thunk>>,
-                std::negation<std::is_constructible<list_rep<T>, F>>,
-                std::is_invocable_r<thunk, std::decay_t<F> &>
-            >
-        > * = nullptr
-    >
-    explicit thunk(F &&f) :
-        detail::thunk_base<list_rep<T>>(std::forward<F>(f)) {
+    void set(typename T::type x) const {
+        detail::thunk_access::assign(*this, std::in_place_index<0>, std::move(x));
     }
 
-    template <
-        class Range,
+    void set(T x) const {
+        detail::thunk_access::assign(*this, std::in_place_index<2>, std::move(x));
+    }
+};
+
+namespace detail {
+
+template <class T>
+struct unstrict {
+    using type = T;
+};
+
+template <class T>
+struct unstrict<strict<T>> {
+    using type = T;
+};
+
+// How an operator reads an operand, which is a thunk or a strict value.
+template <class X>
+struct operand {};
+
+template <class T>
+struct operand<thunk<T>> {
+    using type = T;
+
+    static T const &get(thunk<T> const &x) {
+        return thunk_access::force(x);
+    }
+
+    static T take(thunk<T> const &x) {
+        return thunk_access::take(x);
+    }
+
+    static void restore(thunk<T> const &x, T value) {
+        thunk_access::restore(x, std::move(value));
+    }
+};
+
+template <class T>
+struct operand<cell<T>> :
+    operand<T> {
+};
+
+template <class T>
+struct operand<strict<T>> {
+    using type = typename T::type;
+
+    static type const &get(strict<T> const &x) {
+        return x.get();
+    }
+
+    static type take(strict<T> const &x) {
+        return x.get();
+    }
+
+    static void restore(strict<T> const &, type) {
+    }
+};
+
+template <class X>
+struct is_strict :
+    std::false_type {
+};
+
+template <class T>
+struct is_strict<strict<T>> :
+    std::true_type {
+};
+
+// Whether an operator applies to `X` and `Y` as operands, one of which is strict.
+template <class X, class Y, class = void>
+struct strict_operands :
+    std::false_type {
+};
+
+template <class X, class Y>
+struct strict_operands<X, Y, std::void_t<typename operand<X>::type, typename operand<Y>::type>> :
+    std::bool_constant<is_strict<X>::value || is_strict<Y>::value> {
+};
+
+} // namespace detail {
+
+template <class T>
+class list_rep :
+    public std::variant<std::tuple<>, std::tuple<T, thunk<list_rep<T>>>> {
+public:
+    using std::variant<std::tuple<>, std::tuple<T, thunk<list_rep<T>>>>::variant;
+};
+
+template <class T>
+class thunk<list_rep<T>> :
+    public detail::thunk_base<list_rep<T>> {
+
+    template <class Iterator, class Sentinel>
+    static thunk from_range(Iterator it, Sentinel end) {
+        if (it == end) {
+            return thunk(list_rep<T>(std::in_place_index<0>));
+        } else {
+            auto x = T(*it);
+            return thunk(list_rep<T>(std::in_place_index<1>, x, from_range(++it, end)));
+        }
+    }
+
+    T at(int n) const {
+        if (n < 0) {
+            throw std::out_of_range("operator[]: negative index");
+        } else if (auto rep = this->get(); rep.index() == 0) {
+            throw std::out_of_range("operator[]: index too large");
+        } else if (auto [x, xs] = std::get<1>(rep); n == 0) {
+            return x;
+        } else {
+            return xs.at(n - 1);
+        }
+    }
+
+public:
+    using detail::thunk_base<list_rep<T>>::thunk_base;
+
+    thunk(thunk const &) = default;
+    thunk(thunk &&) = default;
+
+    thunk &operator=(thunk other) {
+        thunk old(std::move(*this));
+        detail::thunk_base<list_rep<T>>::operator=(std::move(other));
+        return *this;
+    }
+
+    ~thunk() {
+        detail::thunk_access::release(*this);
+    }
+
+    // In Clang, thunk_base(U &&) and thunk_base(F &&) are hidden by thunk(Range &&).
+    template <
+        class U,
+        std::enable_if_t<
+            std::conjunction_v<
+                std::negation<std::is_same<std::decay_t<U>, thunk>>,
+                std::is_constructible<list_rep<T>, U>
+            >
+        > * = nullptr
+    >
+    explicit thunk(U &&u) :
+        detail::thunk_base<list_rep<T>>(std::forward<U>(u)) {
+    }
+
+    template <
+        class F,
+        std::enable_if_t<
+            std::conjunction_v<
+                std::negation<std::is_same<std::decay_t<F>, thunk>>,
+                std::negation<std::is_constructible<list_rep<T>, F>>,
+                std::is_invocable_r<thunk, std::decay_t<F> &>
+            >
+        > * = nullptr
+    >
+    explicit thunk(F &&f) :
+        detail::thunk_base<list_rep<T>>(std::forward<F>(f)) {
+    }
+
+    template <
+        class Range,
         std::enable_if_t<
             std::conjunction_v<
                 std::negation<std::is_same<std::decay_t<Range>, thunk>>,
@@ -282,8 +1006,13 @@ public:
 
     template <class Container>
     Container get_as() const {
-        auto rv = to_reversed_vector<typename Container::value_type>();
-        return Container(rv.rbegin(), rv.rend());
+        std::vector<typename Container::value_type> v;
+        for (auto rep = this->get(); rep.index() != 0; ) {
+            auto [x, xs] = std::get<1>(rep);
+            v.push_back(x.template get_as<typename Container::value_type>());
+            rep = xs.get();
+        }
+        return Container(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
     }
 
     T operator[](int_ n) const {
@@ -333,9 +1062,9 @@ namespace detail {
 template <class Sig>
 class function_helper {};
 
-template <class ...Args, class F, class R = std::invoke_result_t<F &, Args...>>
-inline function<R (Args...)> operator*(function_helper<void (Args...)>, F &&f) {
-    return function<R (Args...)>(std::move(f));
+template <class ...Args, class F, class R = typename unstrict<std::invoke_result_t<F &, Args...>>::type>
+inline static_function<R (Args...), F> operator*(function_helper<void (Args...)>, F &&f) {
+    return static_function<R (Args...), F>(std::move(f));
 }
 
 } // namespace detail {
@@ -348,6 +1077,12 @@ inline function<R (Args...)> operator*(function_helper<void (Args...)>, F &&f) {
 #define EASYLAZY_UNARY_OPERATOR(op)                                            \
 template <class T, class R = thunk<decltype(op std::declval<T>())>>            \
 inline R operator op(thunk<T> x) {                                             \
+    return R([=]() {                                                           \
+        return R(op detail::thunk_access::take(x));                            \
+    });                                                                        \
+}                                                                              \
+template <class T, class R = thunk<decltype(op std::declval<typename T::type>())>> \
+inline R operator op(strict<T> x) {                                            \
     return R([=]() {                                                           \
         return R(op x.get());                                                  \
     });                                                                        \
@@ -366,27 +1101,69 @@ inline R operator op(thunk<T> x, thunk<U> y) {                                 \
         return R(x.get() op y.get());                                          \
     });                                                                        \
 }                                                                              \
+template <class X, class Y, class = std::enable_if_t<detail::strict_operands<X, Y>::value>, \
+    class R = thunk<decltype(std::declval<typename detail::operand<X>::type>() op \
+        std::declval<typename detail::operand<Y>::type>())>>                   \
+inline R operator op(X x, Y y) {                                               \
+    return R([=]() {                                                           \
+        return R(detail::operand<X>::get(x) op detail::operand<Y>::get(y));    \
+    });                                                                        \
+}                                                                              \
 /**/
-EASYLAZY_BINARY_OPERATOR(*)
-EASYLAZY_BINARY_OPERATOR(/)
-EASYLAZY_BINARY_OPERATOR(%)
-EASYLAZY_BINARY_OPERATOR(+)
-EASYLAZY_BINARY_OPERATOR(-)
-EASYLAZY_BINARY_OPERATOR(<<)
-EASYLAZY_BINARY_OPERATOR(>>)
 EASYLAZY_BINARY_OPERATOR(<)
 EASYLAZY_BINARY_OPERATOR(>)
 EASYLAZY_BINARY_OPERATOR(<=)
 EASYLAZY_BINARY_OPERATOR(>=)
 EASYLAZY_BINARY_OPERATOR(==)
 EASYLAZY_BINARY_OPERATOR(!=)
-EASYLAZY_BINARY_OPERATOR(&)
-EASYLAZY_BINARY_OPERATOR(^)
-EASYLAZY_BINARY_OPERATOR(|)
 EASYLAZY_BINARY_OPERATOR(&&)
 EASYLAZY_BINARY_OPERATOR(||)
 #undef EASYLAZY_BINARY_OPERATOR
 
+// The left operand is taken after the right one is resolved, so that it can be
+// updated in place if nothing else refers to it. It is put back if the operator throws.
+#define EASYLAZY_ARITHMETIC_OPERATOR(op)                                       \
+template <class T, class U, class R = thunk<decltype(std::declval<T>() op std::declval<U>())>> \
+inline R operator op(thunk<T> x, thunk<U> y) {                                 \
+    return R([=]() {                                                           \
+        auto const &b = detail::thunk_access::force(y);                        \
+        auto a = detail::thunk_access::take(x);                                \
+        try {                                                                  \
+            return R(std::move(a) op b);                                       \
+        } catch (...) {                                                        \
+            detail::thunk_access::restore(x, std::move(a));                    \
+            throw;                                                             \
+        }                                                                      \
+    });                                                                        \
+}                                                                              \
+template <class X, class Y, class = std::enable_if_t<detail::strict_operands<X, Y>::value>, \
+    class R = thunk<decltype(std::declval<typename detail::operand<X>::type>() op \
+        std::declval<typename detail::operand<Y>::type>())>>                   \
+inline R operator op(X x, Y y) {                                               \
+    return R([=]() {                                                           \
+        auto const &b = detail::operand<Y>::get(y);                            \
+        auto a = detail::operand<X>::take(x);                                  \
+        try {                                                                  \
+            return R(std::move(a) op b);                                       \
+        } catch (...) {                                                        \
+            detail::operand<X>::restore(x, std::move(a));                      \
+            throw;                                                             \
+        }                                                                      \
+    });                                                                        \
+}                                                                              \
+/**/
+EASYLAZY_ARITHMETIC_OPERATOR(*)
+EASYLAZY_ARITHMETIC_OPERATOR(/)
+EASYLAZY_ARITHMETIC_OPERATOR(%)
+EASYLAZY_ARITHMETIC_OPERATOR(+)
+EASYLAZY_ARITHMETIC_OPERATOR(-)
+EASYLAZY_ARITHMETIC_OPERATOR(<<)
+EASYLAZY_ARITHMETIC_OPERATOR(>>)
+EASYLAZY_ARITHMETIC_OPERATOR(&)
+EASYLAZY_ARITHMETIC_OPERATOR(^)
+EASYLAZY_ARITHMETIC_OPERATOR(|)
+#undef EASYLAZY_ARITHMETIC_OPERATOR
+
 // Functions
 template <class T>
 inline list<T> nil() {
@@ -477,8 +1254,8 @@ inline bool_ operator!=(list<T> xs, list<T> ys) {
     return !(xs == ys);
 }
 
-template <class T, class U>
-inline list<U> map(function<U (T)> f, list<T> xs) {
+template <class F, class T, class U = detail::function_result_t<F>>
+inline list<U> map(F f, list<T> xs) {
     return list<U>([=]() {
         if (null(xs)) {
             return nil<U>();
@@ -499,8 +1276,8 @@ inline list<T> append(list<T> xs, list<T> ys) {
     });
 }
 
-template <class T>
-inline list<T> filter(function<bool_ (T)> p, list<T> x_xs) {
+template <class F, class T, class = detail::function_result_t<F>>
+inline list<T> filter(F p, list<T> x_xs) {
     return list<T>([=]() {
         if (null(x_xs)) {
             return nil<T>();
@@ -549,6 +1326,58 @@ inline int_ length(list<T> xs) {
     });
 }
 
+template <class F, class U, class T = detail::function_result_t<F>>
+inline T foldl(F f, detail::identity_t<T> z, list<U> xs) {
+    return T([=]() {
+        if (null(xs)) {
+            return z;
+        } else {
+            return foldl(f, f(z, head(xs)), tail(xs));
+        }
+    });
+}
+
+// Resolves the accumulator at each step. An accumulator referred to by nothing else
+// is updated in place by the operators. The loop keeps its position when suspended by
+// `try_get`, so that the next call resumes it rather than starting over.
+template <class F, class U, class T = detail::function_result_t<F>>
+inline T foldl_s(F f, detail::identity_t<T> z, list<U> xs) {
+    struct position {
+        T acc;
+        list<U> ys;
+        detail::suspended_reads reads;
+    };
+    auto p = std::make_shared<std::optional<position>>();
+    return T([=]() {
+        // It starts over only if a cell read before it was suspended has been set since.
+        if (!*p || !(*p)->reads.resume()) {
+            p->emplace(position{z, xs, {}});
+        }
+        auto &[acc, ys, reads] = **p;
+        try {
+            for (;;) {
+                detail::thunk_access::force(acc);
+                auto rep = ys.get();
+                if (rep.index() == 0) {
+                    break;
+                }
+                auto [y, next] = std::get<1>(rep);
+                acc = f(acc, y);
+                ys = next;
+            }
+        } catch (detail::suspended const &) {
+            reads.save();
+            throw;
+        } catch (...) {
+            p->reset();
+            throw;
+        }
+        auto result = std::move(acc);
+        p->reset();
+        return result;
+    });
+}
+
 namespace detail {
 
 template <class T>
@@ -571,6 +1400,1279 @@ inline list<T> reverse(list<T> xs) {
     });
 }
 
+template <class T>
+inline list<T> take(int_ n, list<T> xs) {
+    return list<T>([=]() {
+        if (n <= 0_d || null(xs)) {
+            return nil<T>();
+        } else {
+            return cons(head(xs), take(n - 1_d, tail(xs)));
+        }
+    });
+}
+
+template <class T>
+inline list<T> drop(int_ n, list<T> xs) {
+    return list<T>([=]() {
+        if (n <= 0_d || null(xs)) {
+            return xs;
+        } else {
+            return drop(n - 1_d, tail(xs));
+        }
+    });
+}
+
+template <class F, class T, class = detail::function_result_t<F>>
+inline list<T> take_while(F p, list<T> x_xs) {
+    return list<T>([=]() {
+        if (null(x_xs)) {
+            return nil<T>();
+        } else if (T x = head(x_xs); p(x)) {
+            return cons(x, take_while(p, tail(x_xs)));
+        } else {
+            return nil<T>();
+        }
+    });
+}
+
+template <class F, class T, class U, class V = detail::function_result_t<F>>
+inline list<V> zip_with(F f, list<T> xs, list<U> ys) {
+    return list<V>([=]() {
+        if (null(xs) || null(ys)) {
+            return nil<V>();
+        } else {
+            return cons(f(head(xs), head(ys)), zip_with(f, tail(xs), tail(ys)));
+        }
+    });
+}
+
+// Forces each element as its cell is produced.
+template <class F, class T, class U, class V = detail::function_result_t<F>>
+inline list<V> zip_with_s(F f, list<T> xs, list<U> ys) {
+    return list<V>([=]() {
+        if (null(xs) || null(ys)) {
+            return nil<V>();
+        } else {
+            V z = f(head(xs), head(ys));
+            detail::thunk_access::force(z);
+            return cons(z, zip_with_s(f, tail(xs), tail(ys)));
+        }
+    });
+}
+
+template <class T, class U>
+inline list<thunk<std::tuple<T, U>>> zip(list<T> xs, list<U> ys) {
+    using V = thunk<std::tuple<T, U>>;
+    return list<V>([=]() {
+        if (null(xs) || null(ys)) {
+            return nil<V>();
+        } else {
+            return cons(V(std::make_tuple(head(xs), head(ys))), zip(tail(xs), tail(ys)));
+        }
+    });
+}
+
+template <class T>
+inline list<T> repeat(T x) {
+    return list<T>([=]() {
+        return cons(x, repeat(x));
+    });
+}
+
+template <class F, class T = detail::function_result_t<F>>
+inline list<T> iterate(F f, detail::identity_t<T> x) {
+    return list<T>([=]() {
+        return cons(x, iterate(f, f(x)));
+    });
+}
+
+// Forces each element as its cell is produced.
+template <class F, class T = detail::function_result_t<F>>
+inline list<T> iterate_s(F f, detail::identity_t<T> x) {
+    return list<T>([=]() {
+        detail::thunk_access::force(x);
+        return cons(x, iterate_s(f, f(x)));
+    });
+}
+
+template <
+    class F,
+    class P = typename detail::function_result_t<F>::type::value_type,
+    class T = std::tuple_element_t<0, P>,
+    class U = std::tuple_element_t<1, P>
+>
+inline list<T> unfoldr(F f, detail::identity_t<U> b) {
+    return list<T>([=]() {
+        if (auto r = f(b).get(); !r) {
+            return nil<T>();
+        } else {
+            auto [x, b1] = *r;
+            return cons(x, unfoldr(f, b1));
+        }
+    });
+}
+
+template <class F, class U, class T = detail::function_result_t<F>>
+inline list<T> scanl(F f, detail::identity_t<T> q, list<U> ls) {
+    return list<T>([=]() {
+        return cons(q, list<T>([=]() {
+            if (null(ls)) {
+                return nil<T>();
+            } else {
+                return scanl(f, f(q, head(ls)), tail(ls));
+            }
+        }));
+    });
+}
+
+// Forces each element as its cell is produced.
+template <class F, class U, class T = detail::function_result_t<F>>
+inline list<T> scanl_s(F f, detail::identity_t<T> q, list<U> ls) {
+    return list<T>([=]() {
+        detail::thunk_access::force(q);
+        return cons(q, list<T>([=]() {
+            if (null(ls)) {
+                return nil<T>();
+            } else {
+                return scanl_s(f, f(q, head(ls)), tail(ls));
+            }
+        }));
+    });
+}
+
+template <class T>
+inline list<T> insert(T x, list<T> ys) {
+    return list<T>([=]() {
+        if (null(ys)) {
+            return cons(x, nil<T>());
+        } else if (T y = head(ys); y < x) {
+            return cons(y, insert(x, tail(ys)));
+        } else {
+            return cons(x, ys);
+        }
+    });
+}
+
+// Takes from `xs` first on ties.
+template <class T>
+inline list<T> merge(list<T> xs, list<T> ys) {
+    return list<T>([=]() {
+        if (null(xs)) {
+            return ys;
+        } else if (null(ys)) {
+            return xs;
+        } else if (T x = head(xs), y = head(ys); y < x) {
+            return cons(y, merge(xs, tail(ys)));
+        } else {
+            return cons(x, merge(tail(xs), ys));
+        }
+    });
+}
+
+namespace detail {
+
+// A node of a tournament tree over lists, holding the list with the least head below it.
+// Nodes are never modified. Taking an element rebuilds the path from the leaf it came from,
+// so that a computation interrupted halfway leaves the tree as it was.
+template <class T>
+struct merge_node {
+    // Empty if all the lists below are.
+    list<T> winner;
+    std::size_t leaf;
+    std::shared_ptr<merge_node const> left;
+    std::shared_ptr<merge_node const> right;
+};
+
+// The earlier leaf wins ties, which makes merging stable.
+template <class T>
+inline std::shared_ptr<merge_node<T> const> merge_play(
+    std::shared_ptr<merge_node<T> const> l,
+    std::shared_ptr<merge_node<T> const> r
+) {
+    auto const &lrep = thunk_access::force(l->winner);
+    auto const &rrep = thunk_access::force(r->winner);
+    bool right_wins =
+        rrep.index() != 0 &&
+        (lrep.index() == 0 || bool(std::get<0>(std::get<1>(rrep)) < std::get<0>(std::get<1>(lrep))));
+    auto const &w = right_wins ? r : l;
+    return std::make_shared<merge_node<T> const>(merge_node<T>{w->winner, w->leaf, std::move(l), std::move(r)});
+}
+
+template <class T>
+using merge_tree = thunk<std::shared_ptr<merge_node<T> const>>;
+
+// Every subtree is a thunk, so that the matches already played survive a suspension by `try_get`.
+template <class T>
+inline merge_tree<T> merge_build(std::vector<list<T>> const &xss, std::size_t lo, std::size_t hi) {
+    if (hi - lo == 1) {
+        return merge_tree<T>(std::make_shared<merge_node<T> const>(merge_node<T>{xss[lo], lo, nullptr, nullptr}));
+    } else {
+        auto mid = lo + (hi - lo) / 2;
+        auto l = merge_build(xss, lo, mid);
+        auto r = merge_build(xss, mid, hi);
+        return merge_tree<T>([=]() {
+            return merge_tree<T>(merge_play(l.get(), r.get()));
+        });
+    }
+}
+
+// Replaces the winner by its tail, replaying only the matches on its path.
+template <class T>
+inline std::shared_ptr<merge_node<T> const> merge_pop(
+    std::shared_ptr<merge_node<T> const> const &t,
+    std::size_t lo,
+    std::size_t hi
+) {
+    if (hi - lo == 1) {
+        auto const &xs = std::get<1>(std::get<1>(thunk_access::force(t->winner)));
+        return std::make_shared<merge_node<T> const>(merge_node<T>{xs, lo, nullptr, nullptr});
+    } else if (auto mid = lo + (hi - lo) / 2; t->leaf < mid) {
+        return merge_play(merge_pop(t->left, lo, mid), t->right);
+    } else {
+        return merge_play(t->left, merge_pop(t->right, mid, hi));
+    }
+}
+
+template <class T>
+inline list<T> merge_from(std::shared_ptr<merge_node<T> const> t, std::size_t k) {
+    if (auto const &rep = thunk_access::force(t->winner); rep.index() == 0) {
+        return nil<T>();
+    } else {
+        return cons(std::get<0>(std::get<1>(rep)), list<T>([=]() {
+            return merge_from(merge_pop(t, 0, k), k);
+        }));
+    }
+}
+
+template <class T>
+inline list<T> merge_vector(std::vector<list<T>> const &xss) {
+    if (xss.empty()) {
+        return nil<T>();
+    } else {
+        auto t = merge_build(xss, 0, xss.size());
+        auto k = xss.size();
+        return list<T>([=]() {
+            return merge_from(t.get(), k);
+        });
+    }
+}
+
+} // namespace detail {
+
+// Resolves the head of every list, with k - 1 comparisons, to produce the first element.
+// Each of the others takes log k comparisons.
+template <class T>
+inline list<T> merge_all(list<list<T>> xss) {
+    return list<T>([=]() {
+        std::vector<list<T>> v;
+        for (auto rep = xss.get(); rep.index() != 0; ) {
+            auto [ys, yss] = std::get<1>(rep);
+            v.push_back(ys);
+            rep = yss.get();
+        }
+        return detail::merge_vector(v);
+    });
+}
+
+// A merge sort which produces the first element with n - 1 comparisons, and each of the others
+// with log n comparisons, so that taking m elements costs O(n + m log n).
+template <class T>
+inline list<T> sort(list<T> xs) {
+    return list<T>([=]() {
+        std::vector<list<T>> v;
+        for (auto rep = xs.get(); rep.index() != 0; ) {
+            auto [y, ys] = std::get<1>(rep);
+            v.push_back(cons(y, nil<T>()));
+            rep = ys.get();
+        }
+        return detail::merge_vector(v);
+    });
+}
+
+// Text
+namespace detail {
+
+// An immutable slice of a shared buffer. Slicing does not copy.
+class text_chunk {
+    std::shared_ptr<std::string const> buf;
+    std::size_t off;
+    std::size_t len;
+
+public:
+    explicit text_chunk(std::string s) :
+        buf(std::make_shared<std::string const>(std::move(s))), off(0), len(buf->size()) {
+    }
+
+    text_chunk slice(std::size_t pos, std::size_t n) const {
+        auto c = *this;
+        c.off += pos;
+        c.len = n;
+        return c;
+    }
+
+    char const *data() const {
+        return buf->data() + off;
+    }
+
+    std::size_t size() const {
+        return len;
+    }
+};
+
+inline unsigned count_trailing_zeros(unsigned x) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return unsigned(i);
+#else
+    return unsigned(__builtin_ctz(x));
+#endif
+}
+
+// Returns the index of the first byte at which `p` and `q` differ, or `n`.
+inline std::size_t mismatch(char const *p, char const *q, std::size_t n) {
+    std::size_t i = 0;
+#ifdef EASYLAZY_DETAIL_AVX2
+    for (; i + 32 <= n; i += 32) {
+        auto a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(q + i));
+        if (auto m = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))); m != 0xFFFFFFFFu) {
+            return i + count_trailing_zeros(~m);
+        }
+    }
+#endif
+#ifdef EASYLAZY_DETAIL_SSE2
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(q + i));
+        if (auto m = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))); m != 0xFFFFu) {
+            return i + count_trailing_zeros(~m);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (p[i] != q[i]) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// Returns the index of the first `c` in `p`, or `n`.
+inline std::size_t find_byte(char const *p, std::size_t n, char c) {
+    std::size_t i = 0;
+#ifdef EASYLAZY_DETAIL_AVX2
+    auto c32 = _mm256_set1_epi8(c);
+    for (; i + 32 <= n; i += 32) {
+        auto a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i));
+        if (auto m = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, c32))); m != 0) {
+            return i + count_trailing_zeros(m);
+        }
+    }
+#endif
+#ifdef EASYLAZY_DETAIL_SSE2
+    auto c16 = _mm_set1_epi8(c);
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i));
+        if (auto m = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(a, c16))); m != 0) {
+            return i + count_trailing_zeros(m);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (p[i] == c) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// Returns the index of the first occurrence of `needle` in `haystack`, or `npos`.
+inline std::size_t search(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) {
+        return 0;
+    }
+    for (std::size_t i = 0; needle.size() <= haystack.size() - i; ++i) {
+        i += find_byte(haystack.data() + i, haystack.size() - i - needle.size() + 1, needle[0]);
+        if (needle.size() > haystack.size() - i) {
+            break;
+        } else if (mismatch(haystack.data() + i + 1, needle.data() + 1, needle.size() - 1) == needle.size() - 1) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace detail {
+
+class text_rep;
+
+// A lazy text is a lazy list of evaluated, non-empty chunks.
+template <>
+class thunk<text_rep> :
+    public detail::thunk_base<text_rep> {
+public:
+    using detail::thunk_base<text_rep>::thunk_base;
+
+    explicit thunk(std::string s);
+
+    template <class Container>
+    Container get_as() const;
+};
+
+class text_rep :
+    public std::variant<std::tuple<>, std::tuple<detail::text_chunk, thunk<text_rep>>> {
+public:
+    using std::variant<std::tuple<>, std::tuple<detail::text_chunk, thunk<text_rep>>>::variant;
+};
+
+using text = thunk<text_rep>;
+
+namespace detail {
+
+inline constexpr std::size_t text_chunk_size = 256;
+
+inline text make_text(std::vector<text_chunk> const &chunks, text rest) {
+    for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+        rest = text(text_rep(std::in_place_index<1>, *it, rest));
+    }
+    return rest;
+}
+
+// A read position in a text.
+class text_cursor {
+    text_rep rep;
+    std::size_t pos = 0;
+
+public:
+    explicit text_cursor(text t) :
+        rep(t.get()) {
+    }
+
+    bool done() const {
+        return rep.index() == 0;
+    }
+
+    // The unread part of the current chunk.
+    text_chunk chunk() const {
+        auto const &c = std::get<0>(std::get<1>(rep));
+        return c.slice(pos, c.size() - pos);
+    }
+
+    // Skips `n` bytes, which must not exceed `chunk().size()`.
+    void advance(std::size_t n) {
+        if (pos += n; pos == std::get<0>(std::get<1>(rep)).size()) {
+            rep = std::get<1>(std::get<1>(rep)).get();
+            pos = 0;
+        }
+    }
+
+    // The unread part of the text.
+    text rest() const {
+        if (done()) {
+            return text(text_rep(std::in_place_index<0>));
+        } else {
+            return text(text_rep(std::in_place_index<1>, chunk(), std::get<1>(std::get<1>(rep))));
+        }
+    }
+};
+
+// Compares as `std::string` does, that is, as unsigned bytes.
+inline int compare(text x, text y) {
+    text_cursor xc(x);
+    text_cursor yc(y);
+    while (!xc.done() && !yc.done()) {
+        auto u = xc.chunk();
+        auto v = yc.chunk();
+        auto n = std::min(u.size(), v.size());
+        if (auto i = mismatch(u.data(), v.data(), n); i != n) {
+            return (unsigned char)u.data()[i] < (unsigned char)v.data()[i] ? -1 : 1;
+        }
+        xc.advance(n);
+        yc.advance(n);
+    }
+    return xc.done() ? (yc.done() ? 0 : -1) : 1;
+}
+
+inline list<text> split_impl(char c, bool skip_last, text t) {
+    return list<text>([=]() {
+        text_cursor tc(t);
+        if (skip_last && tc.done()) {
+            return nil<text>();
+        }
+        std::vector<text_chunk> piece;
+        while (!tc.done()) {
+            auto u = tc.chunk();
+            if (auto i = find_byte(u.data(), u.size(), c); i != u.size()) {
+                if (i != 0) {
+                    piece.push_back(u.slice(0, i));
+                }
+                tc.advance(i + 1);
+                return cons(make_text(piece, text(text_rep(std::in_place_index<0>))), split_impl(c, skip_last, tc.rest()));
+            }
+            piece.push_back(u);
+            tc.advance(u.size());
+        }
+        return cons(make_text(piece, text(text_rep(std::in_place_index<0>))), nil<text>());
+    });
+}
+
+} // namespace detail {
+
+inline thunk<text_rep>::thunk(std::string s) :
+    thunk(
+        s.empty()
+            ? text_rep(std::in_place_index<0>)
+            : text_rep(std::in_place_index<1>, detail::text_chunk(std::move(s)), thunk(text_rep(std::in_place_index<0>)))
+    ) {
+}
+
+template <class Container>
+inline Container thunk<text_rep>::get_as() const {
+    std::string s;
+    for (detail::text_cursor tc(*this); !tc.done(); ) {
+        auto u = tc.chunk();
+        s.append(u.data(), u.size());
+        tc.advance(u.size());
+    }
+    return Container(s.begin(), s.end());
+}
+
+inline text pack(string s) {
+    return text([=]() {
+        std::string buf;
+        auto xs = s;
+        for (auto rep = xs.get(); rep.index() != 0; rep = xs.get()) {
+            auto [x, rest] = std::get<1>(rep);
+            buf.push_back(x.get());
+            xs = rest;
+            if (buf.size() == detail::text_chunk_size) {
+                break;
+            }
+        }
+        if (buf.empty()) {
+            return text(text_rep(std::in_place_index<0>));
+        } else {
+            return text(text_rep(std::in_place_index<1>, detail::text_chunk(std::move(buf)), pack(xs)));
+        }
+    });
+}
+
+inline string unpack(text t) {
+    return string([=]() {
+        if (auto rep = t.get(); rep.index() == 0) {
+            return nil<char_>();
+        } else {
+            auto [u, us] = std::get<1>(rep);
+            auto xs = unpack(us);
+            for (auto i = u.size(); i-- != 0; ) {
+                xs = cons(char_(u.data()[i]), xs);
+            }
+            return xs;
+        }
+    });
+}
+
+inline bool_ operator<(text x, text y) {
+    return bool_([=]() {
+        return bool_(detail::compare(x, y) < 0);
+    });
+}
+
+inline bool_ operator>(text x, text y) {
+    return y < x;
+}
+
+inline bool_ operator<=(text x, text y) {
+    return !(y < x);
+}
+
+inline bool_ operator>=(text x, text y) {
+    return !(x < y);
+}
+
+inline bool_ operator==(text x, text y) {
+    return bool_([=]() {
+        return bool_(detail::compare(x, y) == 0);
+    });
+}
+
+inline bool_ operator!=(text x, text y) {
+    return !(x == y);
+}
+
+// Returns the index of the first occurrence of `needle` in `haystack`, or -1.
+inline int_ find(text needle, text haystack) {
+    return int_([=]() {
+        auto n = needle.get_as<std::string>();
+        if (n.empty()) {
+            return 0_d;
+        }
+        // `seam` holds the last `n.size() - 1` bytes read, to find an occurrence across chunks.
+        std::string seam;
+        std::size_t base = 0;
+        for (detail::text_cursor tc(haystack); !tc.done(); ) {
+            auto u = tc.chunk();
+            auto v = std::string_view(u.data(), u.size());
+            if (!seam.empty()) {
+                auto w = seam;
+                w.append(v.substr(0, n.size() - 1));
+                if (auto i = detail::search(w, n); i != std::string_view::npos) {
+                    return int_(int(base - seam.size() + i));
+                }
+            }
+            if (auto i = detail::search(v, n); i != std::string_view::npos) {
+                return int_(int(base + i));
+            }
+            if (v.size() >= n.size() - 1) {
+                seam.assign(v.substr(v.size() - (n.size() - 1)));
+            } else if (seam.append(v); seam.size() > n.size() - 1) {
+                seam.erase(0, seam.size() - (n.size() - 1));
+            }
+            base += v.size();
+            tc.advance(u.size());
+        }
+        return int_(-1);
+    });
+}
+
+inline list<text> split(char_ c, text t) {
+    return list<text>([=]() {
+        return detail::split_impl(c.get(), false, t);
+    });
+}
+
+inline list<text> lines(text t) {
+    return list<text>([=]() {
+        return detail::split_impl('\n', true, t);
+    });
+}
+
+inline namespace literals {
+
+inline text operator"" _t(char const *s, std::size_t n) {
+    return text(std::string(s, n));
+}
+
+} // inline namespace literals {
+
+// Budgeted evaluation
+template <class T>
+inline std::variant<T, suspension> try_get(thunk<T> const &x, budget b) {
+    detail::budget_state state(std::move(b));
+    struct restore {
+        detail::budget_state *outer;
+
+        ~restore() {
+            detail::current_budget() = outer;
+        }
+    } r{std::exchange(detail::current_budget(), &state)};
+    try {
+        return x.get();
+    } catch (detail::suspended const &s) {
+        return s.reason;
+    }
+}
+
+// Channel
+namespace detail {
+
+template <class T>
+class channel_state {
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<T> queue;
+    std::size_t capacity;
+    bool closed = false;
+    bool listed = false;
+    bool abandoned = false;
+
+public:
+    explicit channel_state(std::size_t capacity_) :
+        capacity(capacity_) {
+        if (capacity == 0) {
+            throw std::invalid_argument("channel: zero capacity");
+        }
+        queue.reserve(capacity);
+    }
+
+    bool push(T x) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&]() { return queue.size() < capacity || closed || abandoned; });
+        if (closed) {
+            throw std::logic_error("channel: push after close");
+        } else if (abandoned) {
+            return false;
+        }
+        queue.push_back(std::move(x));
+        // The consumer waits only for an empty queue.
+        if (queue.size() == 1) {
+            lock.unlock();
+            not_empty.notify_one();
+        }
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    // Called when the list is no longer referred to, which wakes a blocked producer.
+    void abandon() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abandoned = true;
+            queue.clear();
+        }
+        not_full.notify_all();
+    }
+
+    // The list is handed out once, so that no channel keeps its head alive.
+    void claim_list() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (listed) {
+            throw std::logic_error("channel: list already taken");
+        }
+        listed = true;
+    }
+
+    // Takes all the queued elements at once. Returns an empty batch only after `close`.
+    std::vector<T> take_all() {
+        std::vector<T> batch;
+        batch.reserve(capacity);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [&]() { return !queue.empty() || closed; });
+            batch.swap(queue);
+        }
+        not_full.notify_all();
+        return batch;
+    }
+};
+
+// Shared by the unresolved cells of the list, and so destroyed when the consumer drops it.
+template <class T>
+struct channel_reader {
+    std::shared_ptr<channel_state<T>> state;
+
+    explicit channel_reader(std::shared_ptr<channel_state<T>> state_) :
+        state(std::move(state_)) {
+    }
+
+    channel_reader(channel_reader const &) = delete;
+    channel_reader &operator=(channel_reader const &) = delete;
+
+    ~channel_reader() {
+        state->abandon();
+    }
+};
+
+template <class T>
+inline list<T> channel_list(std::shared_ptr<channel_reader<T>> reader) {
+    return list<T>([=]() {
+        auto batch = reader->state->take_all();
+        auto xs = batch.empty() ? nil<T>() : channel_list(reader);
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            xs = cons(*it, xs);
+        }
+        return xs;
+    });
+}
+
+} // namespace detail {
+
+template <class T>
+class channel {
+    std::shared_ptr<detail::channel_state<T>> state;
+
+public:
+    explicit channel(std::size_t capacity = 64) :
+        state(std::make_shared<detail::channel_state<T>>(capacity)) {
+    }
+
+    bool push(T x) const {
+        return state->push(std::move(x));
+    }
+
+    void close() const {
+        state->close();
+    }
+
+    list<T> as_list() const {
+        state->claim_list();
+        return detail::channel_list(std::make_shared<detail::channel_reader<T>>(state));
+    }
+};
+
+#ifdef EASYLAZY_ENABLE_PERSISTENCE
+// Persistence
+
+// Specialize `serializer<T>` with
+// `static void save(T const &, std::string &)` and `static T load(std::string_view &)`
+// to persist values of type `T`. `load` consumes what it reads from the front of its argument.
+template <class T, class = void>
+struct serializer {};
+
+namespace detail {
+
+inline void save_u64(std::uint64_t n, std::string &out) {
+    out.append(reinterpret_cast<char const *>(&n), sizeof(n));
+}
+
+inline std::string_view load_bytes(std::string_view &in, std::size_t n) {
+    if (in.size() < n) {
+        throw std::runtime_error("persistent_cache: truncated entry");
+    }
+    auto bytes = in.substr(0, n);
+    in.remove_prefix(n);
+    return bytes;
+}
+
+inline std::uint64_t load_u64(std::string_view &in) {
+    std::uint64_t n;
+    std::memcpy(&n, load_bytes(in, sizeof(n)).data(), sizeof(n));
+    return n;
+}
+
+inline void save_string(std::string_view s, std::string &out) {
+    save_u64(s.size(), out);
+    out.append(s);
+}
+
+inline std::string_view load_string(std::string_view &in) {
+    return load_bytes(in, load_u64(in));
+}
+
+} // namespace detail {
+
+template <class T>
+struct serializer<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    static void save(T const &x, std::string &out) {
+        out.append(reinterpret_cast<char const *>(&x), sizeof(T));
+    }
+
+    static T load(std::string_view &in) {
+        T x;
+        std::memcpy(&x, detail::load_bytes(in, sizeof(T)).data(), sizeof(T));
+        return x;
+    }
+};
+
+#ifdef EASYLAZY_ENABLE_INTEGER
+template <>
+struct serializer<integer::type> {
+    static void save(integer::type const &x, std::string &out) {
+        std::string bytes;
+        boost::multiprecision::export_bits(abs(x), std::back_inserter(bytes), 8);
+        out.push_back(x < 0 ? '-' : '+');
+        detail::save_string(bytes, out);
+    }
+
+    static integer::type load(std::string_view &in) {
+        auto sign = detail::load_bytes(in, 1)[0];
+        auto bytes = detail::load_string(in);
+        integer::type x;
+        boost::multiprecision::import_bits(x, bytes.begin(), bytes.end(), 8);
+        return sign == '-' ? integer::type(-x) : x;
+    }
+};
+#endif
+
+namespace detail {
+
+// Whether `x` and everything below it are resolved, so that saving it resolves nothing.
+template <class T>
+inline bool resolved_whole(thunk<T> const &x) {
+    return thunk_access::resolved(x);
+}
+
+template <class T>
+inline bool resolved_whole(list<T> const &xs) {
+    for (auto ys = xs; thunk_access::resolved(ys); ) {
+        auto const &rep = thunk_access::force(ys);
+        if (rep.index() == 0) {
+            return true;
+        }
+        auto const &[y, zs] = std::get<1>(rep);
+        if (!resolved_whole(y)) {
+            return false;
+        }
+        ys = zs;
+    }
+    return false;
+}
+
+} // namespace detail {
+
+// A list is saved as far as it has been resolved. The rest of a list loaded from a partial entry
+// is taken from `source`, or it is an error to load one without.
+template <class T>
+struct serializer<list_rep<T>> {
+    static void save(list_rep<T> const &rep, std::string &out) {
+        auto count_pos = out.size();
+        detail::save_u64(0, out);
+        std::uint64_t count = 0;
+        bool complete = false;
+        for (auto r = rep; ; ) {
+            if (r.index() == 0) {
+                complete = true;
+                break;
+            }
+            auto [x, xs] = std::get<1>(r);
+            if (!detail::resolved_whole(x)) {
+                break;
+            }
+            serializer<typename T::type>::save(x.get(), out);
+            ++count;
+            if (!detail::thunk_access::resolved(xs)) {
+                break;
+            }
+            r = xs.get();
+        }
+        std::memcpy(&out[count_pos], &count, sizeof(count));
+        out.push_back(complete ? 1 : 0);
+    }
+
+    static list_rep<T> load(std::string_view &in) {
+        return load(in, list<T>([]() -> list<T> {
+            throw std::runtime_error("persistent_cache: partial entry");
+        }));
+    }
+
+    static list_rep<T> load(std::string_view &in, list<T> source) {
+        std::vector<T> xs;
+        for (auto n = detail::load_u64(in); n != 0; --n) {
+            xs.push_back(T(serializer<typename T::type>::load(in)));
+        }
+        auto l = nil<T>();
+        if (detail::load_bytes(in, 1)[0] == 0) {
+            // Skipped in a loop, so that a long prefix does not take a deep recursion.
+            l = list<T>([source, n = xs.size()]() {
+                auto rep = source.get();
+                for (auto i = n; i != 0 && rep.index() != 0; --i) {
+                    rep = std::get<1>(std::get<1>(rep)).get();
+                }
+                return list<T>(std::move(rep));
+            });
+        }
+        // Built from the back, so that a long list does not take a deep recursion.
+        for (auto it = xs.rbegin(); it != xs.rend(); ++it) {
+            l = cons(*it, l);
+        }
+        return l.get();
+    }
+};
+
+namespace detail {
+
+template <class T>
+inline T load_entry(std::string_view &in, thunk<T> const &) {
+    return serializer<T>::load(in);
+}
+
+template <class T>
+inline list_rep<T> load_entry(std::string_view &in, list<T> const &source) {
+    return serializer<list_rep<T>>::load(in, source);
+}
+
+} // namespace detail {
+
+namespace detail {
+
+// A read-only view of a whole file, which is empty if the file cannot be read.
+// Pages are mapped on demand where `mmap` is available.
+class mapped_file {
+    char const *ptr = nullptr;
+    std::size_t len = 0;
+#ifndef EASYLAZY_DETAIL_MMAP
+    std::string buf;
+#endif
+
+public:
+    explicit mapped_file(std::string const &path) {
+#ifdef EASYLAZY_DETAIL_MMAP
+        if (int fd = ::open(path.c_str(), O_RDONLY); fd != -1) {
+            if (struct stat st; ::fstat(fd, &st) == 0 && st.st_size > 0) {
+                if (void *p = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); p != MAP_FAILED) {
+                    ptr = static_cast<char const *>(p);
+                    len = std::size_t(st.st_size);
+                }
+            }
+            ::close(fd);
+        }
+#else
+        if (std::ifstream ifs(path, std::ios::binary); ifs) {
+            buf.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            ptr = buf.data();
+            len = buf.size();
+        }
+#endif
+    }
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file &operator=(mapped_file const &) = delete;
+
+    ~mapped_file() {
+#ifdef EASYLAZY_DETAIL_MMAP
+        if (ptr) {
+            ::munmap(const_cast<char *>(ptr), len);
+        }
+#endif
+    }
+
+    std::string_view view() const {
+        return std::string_view(ptr, len);
+    }
+};
+
+inline constexpr std::string_view cache_magic = "easylazy";
+inline constexpr std::uint64_t cache_format_version = 2;
+
+class persistent_cache_impl {
+    struct entry {
+        std::string type;
+        std::string_view bytes;
+        std::shared_ptr<std::string const> owner; // null if `bytes` points into `file`
+        std::function<std::string ()> pending; // saves the value as far as it has been resolved
+    };
+
+    std::string path;
+    std::uint64_t schema_version;
+    mapped_file file;
+    std::unordered_map<std::string, entry> entries;
+
+public:
+    persistent_cache_impl(std::string path_, std::uint64_t schema_version_) :
+        path(std::move(path_)), schema_version(schema_version_), file(path) {
+        // A file written by another version or schema, or a broken one, is ignored.
+        try {
+            auto in = file.view();
+            if (in.empty()) {
+                return;
+            } else if (
+                load_bytes(in, cache_magic.size()) != cache_magic ||
+                load_u64(in) != cache_format_version ||
+                load_u64(in) != schema_version
+            ) {
+                return;
+            }
+            for (auto n = load_u64(in); n != 0; --n) {
+                auto key = load_string(in);
+                auto type = load_string(in);
+                auto bytes = load_string(in);
+                entries.insert_or_assign(std::string(key), entry{std::string(type), bytes, nullptr, {}});
+            }
+        } catch (std::runtime_error const &) {
+            entries.clear();
+        }
+    }
+
+    std::optional<std::string_view> find(std::string const &key, std::string_view type) {
+        if (auto it = entries.find(key); it != entries.end() && it->second.type == type) {
+            flush(it->second);
+            return it->second.bytes;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    // Values are saved when the cache is, so that what is resolved after `memoize` is saved too.
+    void store(std::string const &key, std::string_view type, std::function<std::string ()> pending) {
+        entries.insert_or_assign(key, entry{std::string(type), std::string_view(), nullptr, std::move(pending)});
+    }
+
+    void flush(entry &e) {
+        if (e.pending) {
+            e.owner = std::make_shared<std::string const>(e.pending());
+            e.bytes = *e.owner;
+        }
+    }
+
+    void save() {
+        for (auto &[key, e] : entries) {
+            flush(e);
+        }
+        std::string out(cache_magic);
+        save_u64(cache_format_version, out);
+        save_u64(schema_version, out);
+        save_u64(entries.size(), out);
+        for (auto const &[key, e] : entries) {
+            save_string(key, out);
+            save_string(e.type, out);
+            save_string(e.bytes, out);
+        }
+        // Replace the file atomically; the current mapping stays valid.
+        auto tmp = path + ".tmp";
+        if (std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc); !(ofs && ofs.write(out.data(), std::streamsize(out.size())))) {
+            throw std::runtime_error("persistent_cache: cannot write " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(path.c_str());
+            if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+                throw std::runtime_error("persistent_cache: cannot write " + path);
+            }
+        }
+    }
+};
+
+} // namespace detail {
+
+class persistent_cache {
+    std::shared_ptr<detail::persistent_cache_impl> pimpl;
+
+public:
+    persistent_cache(std::string path, std::uint64_t schema_version) :
+        pimpl(std::make_shared<detail::persistent_cache_impl>(std::move(path), schema_version)) {
+    }
+
+    // The cache holds the value until it is destroyed, and saves a list as far as it has been
+    // resolved when `save` is called.
+    template <class T>
+    thunk<T> memoize(std::string key, thunk<T> x) const {
+        return thunk<T>([=, pimpl = pimpl]() {
+            auto type = std::string_view(typeid(T).name());
+            std::optional<T> value;
+            if (auto bytes = pimpl->find(key, type)) {
+                auto in = *bytes;
+                value.emplace(detail::load_entry(in, x));
+                if (!in.empty()) {
+                    throw std::runtime_error("persistent_cache: broken entry " + key);
+                }
+            } else {
+                value.emplace(x.get());
+            }
+            pimpl->store(key, type, [v = *value]() {
+                std::string out;
+                serializer<T>::save(v, out);
+                return out;
+            });
+            return thunk<T>(std::move(*value));
+        });
+    }
+
+    void save() const {
+        pimpl->save();
+    }
+};
+#endif
+
+// Normal form
+class nf_stack;
+
+// Specialize `nf_traits<T>` with
+// `static void force(T const &, nf_stack &)` for a type that contains sub-thunks.
+// A type without a specialization is regarded as having no sub-thunks.
+template <class T>
+struct nf_traits {};
+
+namespace detail {
+
+template <class T, class = void>
+struct has_sub_thunks :
+    std::false_type {};
+
+template <class T>
+struct has_sub_thunks<T, std::void_t<decltype(&nf_traits<T>::force)>> :
+    std::true_type {};
+
+} // namespace detail {
+
+class nf_stack {
+    std::vector<std::function<void (nf_stack &)>> tasks;
+
+    template <class T>
+    friend T deep_force(T x);
+
+    void run() {
+        while (!tasks.empty()) {
+            auto task = std::move(tasks.back());
+            tasks.pop_back();
+            task(*this);
+        }
+    }
+
+public:
+    // Resolves `x` now if it has no sub-thunks; otherwise defers it.
+    template <class T>
+    void push(thunk<T> x) {
+        if constexpr (detail::has_sub_thunks<T>::value) {
+            tasks.emplace_back([x](nf_stack &s) {
+                nf_traits<T>::force(detail::thunk_access::force(x), s);
+            });
+        } else {
+            detail::thunk_access::force(x);
+        }
+    }
+
+    template <class T>
+    void push(T const &x) {
+        if constexpr (detail::has_sub_thunks<T>::value) {
+            nf_traits<T>::force(x, *this);
+        }
+    }
+};
+
+template <class ...Ts>
+struct nf_traits<std::tuple<Ts...>> {
+    static void force(std::tuple<Ts...> const &t, nf_stack &s) {
+        std::apply([&](auto const &...xs) {
+            (s.push(xs), ...);
+        }, t);
+    }
+};
+
+template <class T>
+struct nf_traits<std::optional<T>> {
+    static void force(std::optional<T> const &x, nf_stack &s) {
+        if (x) {
+            s.push(*x);
+        }
+    }
+};
+
+template <class T>
+struct nf_traits<list_rep<T>> {
+    // Walks the spine in a loop so that a long list does not fill the stack.
+    static void force(list_rep<T> const &rep, nf_stack &s) {
+        for (auto r = rep; r.index() != 0; ) {
+            auto [x, xs] = std::get<1>(r);
+            s.push(x);
+            r = xs.get();
+        }
+    }
+};
+
+template <>
+struct nf_traits<text_rep> {
+    static void force(text_rep const &rep, nf_stack &) {
+        for (auto r = rep; r.index() != 0; ) {
+            r = std::get<1>(std::get<1>(r)).get();
+        }
+    }
+};
+
+template <class T>
+inline T deep_force(T x) {
+    nf_stack s;
+    s.push(x);
+    s.run();
+    return x;
+}
+
+template <class T, class U>
+inline U deepseq(T x, U y) {
+    return U([=]() {
+        deep_force(x);
+        return y;
+    });
+}
+
 } // namespace easylazy {
 
 #endif // #ifndef EASYLAZY_HPP_INCLUDED
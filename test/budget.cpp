@@ -0,0 +1,109 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <chrono>
+#include <variant>
+#include <boost/core/lightweight_test.hpp>
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+budget steps(std::size_t n) {
+    budget b;
+    b.steps = n;
+    return b;
+}
+
+int_ tarai(int_ x, int_ y, int_ z) {
+    return int_([=]() {
+        if (x <= y) {
+            return y;
+        } else {
+            return tarai(tarai(x - 1_d, y, z), tarai(y - 1_d, z, x), tarai(z - 1_d, x, y));
+        }
+    });
+}
+
+int main() {
+    int_ n = tarai(200_d, 100_d, 0_d);
+    int suspensions = 0;
+    for (;;) {
+        auto r = try_get(n, steps(100));
+        if (auto v = std::get_if<int>(&r)) {
+            BOOST_TEST(*v == 200);
+            break;
+        }
+        BOOST_TEST(std::get<suspension>(r) == suspension::steps_exhausted);
+        ++suspensions;
+    }
+    BOOST_TEST(suspensions > 0);
+    BOOST_TEST(std::get<int>(try_get(n, steps(0))) == 200);
+
+    int_ m = tarai(20_d, 10_d, 0_d);
+    budget past;
+    past.deadline = std::chrono::steady_clock::now();
+    BOOST_TEST(std::get<suspension>(try_get(m, past)) == suspension::deadline_passed);
+
+    budget cancelled;
+    cancelled.token.emplace();
+    cancelled.token->cancel();
+    BOOST_TEST(std::get<suspension>(try_get(m, cancelled)) == suspension::cancelled);
+
+    BOOST_TEST(std::get<int>(try_get(m, budget{})) == 20);
+    BOOST_TEST(tarai(12_d, 6_d, 0_d).get() == 12);
+
+    int_ e([]() -> int_ { throw std::runtime_error("e"); });
+    BOOST_TEST_THROWS(try_get(e, budget{}), std::runtime_error);
+    BOOST_TEST(std::get<suspension>(try_get(tarai(20_d, 10_d, 0_d), steps(3))) == suspension::steps_exhausted);
+    BOOST_TEST(tarai(20_d, 10_d, 0_d).get() == 20);
+
+    // A loop within one computation resumes where it was suspended.
+    auto xs = take(2000_d, iterate_s(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d));
+    int_ sum = foldl_s(EASYLAZY_FUNCTION(int_ a, int_ x) { return a + x; }, 0_d, xs);
+    int calls = 1;
+    auto r = try_get(sum, steps(1000));
+    for (; r.index() != 0 && calls < 100; ++calls) {
+        r = try_get(sum, steps(1000));
+    }
+    BOOST_TEST(std::get<int>(r) == 1999000);
+    BOOST_TEST(calls > 1);
+
+    // It keeps the cells it has read, and is computed again when one of them is set.
+    cell<int_> length(1000);
+    int_ total = foldl_s(
+        EASYLAZY_FUNCTION(int_ a, int_ x) { return a + x; },
+        0_d,
+        take(length, iterate_s(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d))
+    );
+    calls = 1;
+    r = try_get(total, steps(300));
+    for (; r.index() != 0 && calls < 1000; ++calls) {
+        r = try_get(total, steps(300));
+    }
+    BOOST_TEST(std::get<int>(r) == 499500);
+    BOOST_TEST(calls > 1 && calls < 1000);
+    length.set(10);
+    BOOST_TEST(total.get() == 45);
+
+    // A cell set while it is suspended makes it start over.
+    length.set(1000);
+    BOOST_TEST(try_get(total, steps(300)).index() == 1);
+    length.set(5);
+    BOOST_TEST(total.get() == 10);
+
+    // So does the tournament of sort, whose subtrees are thunks.
+    int_ least = head(sort(take(5000_d, iterate_s(EASYLAZY_FUNCTION(int_ x) { return x - 1_d; }, 5000_d))));
+    calls = 1;
+    r = try_get(least, steps(1000));
+    for (; r.index() != 0 && calls < 100; ++calls) {
+        r = try_get(least, steps(1000));
+    }
+    BOOST_TEST(std::get<int>(r) == 1);
+    BOOST_TEST(calls > 1);
+
+    return boost::report_errors();
+}
@@ -0,0 +1,89 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <stdexcept>
+#include <string>
+#include <boost/core/lightweight_test.hpp>
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+int main() {
+    cell<int_> a(1), b(2);
+    int count_s = 0, count_t = 0;
+    int_ s([&, a, b]() {
+        ++count_s;
+        return int_(a.get() + b.get());
+    });
+    int_ t([&, b]() {
+        ++count_t;
+        return int_(b.get() * 10);
+    });
+    int_ u = s + t;
+    BOOST_TEST(u.get() == 23);
+    BOOST_TEST(u.get() == 23);
+    BOOST_TEST(count_s == 1 && count_t == 1);
+
+    a.set(10);
+    BOOST_TEST(a.get() == 10);
+    BOOST_TEST(u.get() == 32);
+    BOOST_TEST(count_s == 2 && count_t == 1);
+
+    b.set(3);
+    BOOST_TEST(s.get() == 13);
+    BOOST_TEST(t.get() == 30);
+    BOOST_TEST(u.get() == 43);
+    BOOST_TEST(count_s == 3 && count_t == 2);
+
+    // A thunk read through another which is no longer referenced.
+    int_ v([=]() {
+        return int_((a * 2_d).get());
+    });
+    BOOST_TEST(v.get() == 20);
+    a.set(4);
+    BOOST_TEST(v.get() == 8);
+
+    cell<int_> n(3);
+    list<int_> xs = take(n, iterate(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d));
+    int_ len = length(xs);
+    BOOST_TEST(len.get() == 3);
+    n.set(5);
+    BOOST_TEST(len.get() == 5);
+    BOOST_TEST((xs == list<int_>{0_d, 1_d, 2_d, 3_d, 4_d}));
+
+    // A cell set to a thunk depends on the cells it reads.
+    cell<int_> c(a + 1_d);
+    int_ w = c * 2_d;
+    BOOST_TEST(w.get() == 10);
+    a.set(7);
+    BOOST_TEST(w.get() == 16);
+    c.set(b + 0_d);
+    BOOST_TEST(w.get() == 6);
+    a.set(100);
+    BOOST_TEST(w.get() == 6);
+
+    cell<list<int_>> ys(list<int_>{1_d, 2_d});
+    int_ sum = foldl_s(EASYLAZY_FUNCTION(int_ x, int_ y) { return x + y; }, 0_d, list<int_>(ys));
+    BOOST_TEST(sum.get() == 3);
+    ys.set(list<int_>{1_d, 2_d, 3_d});
+    BOOST_TEST(sum.get() == 6);
+
+    // An operand captured by a computation which reads a cell is not moved out.
+    cell<thunk<std::string>> str(std::string("y"));
+    thunk<std::string> cat = thunk<std::string>([]() { return thunk<std::string>(std::string("x")); }) + str;
+    BOOST_TEST(cat.get() == "xy");
+    str.set(std::string("z"));
+    BOOST_TEST(cat.get() == "xz");
+
+    int_ bad([=]() {
+        a.set(0);
+        return a;
+    });
+    BOOST_TEST_THROWS(bad.get(), std::logic_error);
+
+    return boost::report_errors();
+}
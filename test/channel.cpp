@@ -0,0 +1,57 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <stdexcept>
+#include <thread>
+#include <boost/core/lightweight_test.hpp>
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+int main() {
+    channel<int_> ch(16);
+    std::thread producer([=]() {
+        for (int i = 0; i < 10000; ++i) {
+            ch.push(int_(i));
+        }
+        ch.close();
+    });
+
+    auto xs = ch.as_list();
+    auto evens = filter(EASYLAZY_FUNCTION(int_ x) { return x % 2_d == 0_d; }, xs);
+    BOOST_TEST(head(evens) == 0_d);
+    BOOST_TEST(evens[4999_d] == 9998_d);
+    BOOST_TEST(null(drop(5000_d, evens)));
+    BOOST_TEST(length(xs) == 10000_d);
+    producer.join();
+
+    BOOST_TEST_THROWS(ch.as_list(), std::logic_error);
+
+    BOOST_TEST_THROWS(ch.push(0_d), std::logic_error);
+    BOOST_TEST_THROWS(channel<int_>(0), std::invalid_argument);
+
+    // The producer is released when the consumer drops the list.
+    channel<int_> dropped(4);
+    int pushed = 0;
+    std::thread stopped([=, &pushed]() {
+        while (dropped.push(int_(pushed))) {
+            ++pushed;
+        }
+    });
+    {
+        auto ys = dropped.as_list();
+        BOOST_TEST(head(ys) == 0_d);
+    }
+    stopped.join();
+    BOOST_TEST(pushed < 100);
+
+    channel<int_> empty;
+    empty.close();
+    BOOST_TEST(null(empty.as_list()));
+
+    return boost::report_errors();
+}
@@ -0,0 +1,54 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <tuple>
+#include <boost/core/lightweight_test.hpp>
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+int main() {
+    int count = 0;
+    auto counted = [&](int n) {
+        return int_([&count, n]() {
+            ++count;
+            return int_(n);
+        });
+    };
+
+    list<int_> xs = cons(counted(1), cons(counted(2), nil<int_>()));
+    BOOST_TEST(count == 0);
+    deep_force(xs);
+    BOOST_TEST(count == 2);
+    deep_force(xs);
+    BOOST_TEST(count == 2);
+
+    count = 0;
+    list<list<int_>> xss = cons(
+        cons(counted(1), nil<int_>()),
+        cons(cons(counted(2), cons(counted(3), nil<int_>())), nil<list<int_>>())
+    );
+    int_ n = deepseq(xss, 4_d);
+    BOOST_TEST(count == 0);
+    BOOST_TEST(n.get() == 4);
+    BOOST_TEST(count == 3);
+
+    count = 0;
+    thunk<std::tuple<int_, list<int_>>> t(std::make_tuple(counted(1), list<int_>{counted(2)}));
+    deep_force(t);
+    BOOST_TEST(count == 2);
+
+    count = 0;
+    list<int_> long_list = nil<int_>();
+    for (int i = 0; i < 100000; ++i) {
+        long_list = cons(counted(i), long_list);
+    }
+    deep_force(long_list);
+    BOOST_TEST(count == 100000);
+
+    return boost::report_errors();
+}
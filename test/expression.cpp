@@ -6,11 +6,43 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <stdexcept>
+#include <string>
 #include <boost/core/lightweight_test.hpp>
 #include "../easylazy.hpp"
 
 using namespace easylazy;
 
+// A string which counts its copies.
+struct blob {
+    static inline int copies = 0;
+    std::string s;
+
+    explicit blob(std::string s_) :
+        s(std::move(s_)) {
+    }
+
+    blob(blob const &other) :
+        s(other.s) {
+        ++copies;
+    }
+
+    blob(blob &&) = default;
+
+    friend blob operator+(blob x, blob const &y) {
+        x.s += y.s;
+        return x;
+    }
+
+    friend blob operator-(blob x, blob const &y) {
+        if (x.s.size() < y.s.size() || x.s.compare(x.s.size() - y.s.size(), y.s.size(), y.s) != 0) {
+            throw std::invalid_argument("blob: not a suffix");
+        }
+        x.s.resize(x.s.size() - y.s.size());
+        return x;
+    }
+};
+
 int main() {
     // Postfix Expressions
     BOOST_TEST((list<int_>{23, 42}[1_d].get()) == 42);
@@ -67,6 +99,24 @@ int main() {
     BOOST_TEST((bool_(false) || bool_(true)).get() == true);
     BOOST_TEST((bool_(false) || 0_d).get() == false);
 
+    // Operands Updated in Place
+    thunk<std::string> s(std::string("ab"));
+    BOOST_TEST((s + s).get() == "abab");
+    BOOST_TEST((s + thunk<std::string>(std::string("c"))).get() == "abc");
+    BOOST_TEST((thunk<std::string>(std::string("c")) + s).get() == "cab");
+    BOOST_TEST((thunk<std::string>(std::string("c")) + s + s).get() == "cabab");
+    BOOST_TEST(s.get() == "ab");
+
+    blob::copies = 0;
+    auto abc = thunk<blob>([]() { return thunk<blob>(blob("a")); }) + thunk<blob>(blob("b")) + thunk<blob>(blob("c"));
+    BOOST_TEST(abc.get().s == "abc");
+    BOOST_TEST(blob::copies == 1); // by get
+
+    // An operand is put back when the operator throws.
+    auto bad = thunk<blob>([]() { return thunk<blob>(blob("xyz")); }) - thunk<blob>(blob("x"));
+    BOOST_TEST_THROWS(bad.get(), std::invalid_argument);
+    BOOST_TEST_THROWS(bad.get(), std::invalid_argument);
+
     // Implicit Type Conversion
     int_ n = ' '_c;
     BOOST_TEST(n.get() == 0x20);
@@ -6,11 +6,62 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+// GCC warns falsely on freeing what the replaced operator new has allocated.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
 #include <boost/core/lightweight_test.hpp>
 #include "../easylazy.hpp"
 
 using namespace easylazy;
 
+// Counts what is allocated, to see that a strict parameter allocates nothing.
+std::size_t allocations = 0;
+
+void *operator new(std::size_t n) {
+    ++allocations;
+    if (void *p = std::malloc(n == 0 ? 1 : n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int_ tarai(strict<int_> x, strict<int_> y, int_ z) {
+    return int_([=]() {
+        if (x <= y) {
+            return int_(y);
+        } else {
+            return tarai(tarai(x - 1_d, y, z), tarai(y - 1_d, z, x), tarai(z - 1_d, x, y));
+        }
+    });
+}
+
+struct counted {
+    static inline int copies = 0;
+
+    counted() = default;
+
+    counted(counted const &) {
+        ++copies;
+    }
+};
+
+int product(strict<int_> x, strict<int_> y) {
+    return x.get() * y.get();
+}
+
 int main() {
     BOOST_TEST(
         (function<int_ (int_, int_)>([](int_ x, int_ y) { return x + y; })(3_d, 4_d).get())
@@ -21,5 +72,61 @@ int main() {
             == 12
     );
 
+    int count = 0;
+    int_ three([&]() {
+        ++count;
+        return 3_d;
+    });
+    auto f = EASYLAZY_FUNCTION(strict<int_> x, int_ y) { return x * y; };
+    auto n = f(three, 4_d);
+    BOOST_TEST(count == 1);
+    BOOST_TEST(n.get() == 12);
+    auto m = f(1_d, int_([]() -> int_ { throw 0; }));
+    BOOST_TEST_THROWS(m.get(), int);
+    BOOST_TEST_THROWS(f(int_([]() -> int_ { throw 0; }), 1_d), int);
+
+    auto g = EASYLAZY_FUNCTION(strict<int_> x) { return x; };
+    BOOST_TEST(g(5_d).get() == 5);
+
+    BOOST_TEST(tarai(200_d, 100_d, 0_d).get() == 200);
+
+    // A strict parameter holds the value, and makes no thunk of its own.
+    {
+        strict<int_> x = 6_d;
+        auto before = allocations;
+        BOOST_TEST(product(x, 7) == 42);
+        BOOST_TEST(product(int_(three), x) == 18);
+        BOOST_TEST(allocations == before);
+        BOOST_TEST((-x).get() == -6);
+        BOOST_TEST((x - 1_d).get() == 5);
+        BOOST_TEST((10_d % x).get() == 4);
+        BOOST_TEST((x == x).get());
+    }
+
+    auto twice = EASYLAZY_FUNCTION(int_ x) { return x * 2_d; };
+    function<int_ (int_)> stored = twice;
+    BOOST_TEST(stored(21_d).get() == 42);
+    BOOST_TEST((map(twice, list<int_>{1_d, 2_d, 3_d}) == map(stored, list<int_>{1_d, 2_d, 3_d})).get());
+    BOOST_TEST(
+        foldl(EASYLAZY_FUNCTION(double_ x, int_ y) { return x + double_(y); }, 0.5_lf, list<int_>{1_d, 2_d}).get()
+            == 3.5
+    );
+
+    // What the body has captured is shared, not copied for each element.
+    {
+        counted c;
+        auto succ = EASYLAZY_FUNCTION(int_ x) {
+            static_cast<void>(c);
+            return x + 1_d;
+        };
+        auto plus = EASYLAZY_FUNCTION(int_ a, int_ x) { return a + x; };
+        counted::copies = 0;
+        auto xs = map(succ, take(1000_d, iterate_s(succ, 0_d)));
+        BOOST_TEST(foldl_s(plus, 0_d, xs).get() == 500500);
+        function<int_ (int_)> stored = succ;
+        BOOST_TEST(foldl_s(plus, 0_d, map(stored, xs)).get() == 501500);
+        BOOST_TEST(counted::copies == 0);
+    }
+
     return boost::report_errors();
 }
@@ -13,6 +13,20 @@
 
 using namespace easylazy;
 
+int comparisons = 0;
+
+struct item {
+    int key;
+    int tag;
+
+    bool operator<(item const &other) const {
+        ++comparisons;
+        return key < other.key;
+    }
+};
+
+using item_ = thunk<item>;
+
 int main() {
     std::vector<int> v{1, 2, 3};
     list<int_> xs1(v);
@@ -78,5 +92,138 @@ int main() {
 
     BOOST_TEST(reverse(list<int_>{1, 2}) == (list<int_>{2, 1}));
 
+    BOOST_TEST(
+        foldl(EASYLAZY_FUNCTION(int_ x, int_ y) { return x - y; }, 10_d, list<int_>{1, 2, 3})
+            == 4_d
+    );
+    BOOST_TEST(
+        foldl_s(EASYLAZY_FUNCTION(thunk<std::string> s, char_ c) { return s + c; }, thunk<std::string>(std::string()), "hello"_s)
+            .get() == "hello"
+    );
+    BOOST_TEST(foldl_s(EASYLAZY_FUNCTION(int_ x, int_ y) { return x + y; }, 0_d, take(100000_d, repeat(1_d))) == 100000_d);
+
+    BOOST_TEST(take(2_d, list<int_>{1, 2, 3}) == (list<int_>{1, 2}));
+    BOOST_TEST(take(5_d, list<int_>{1, 2}) == (list<int_>{1, 2}));
+    BOOST_TEST(take(-1_d, list<int_>{1, 2}) == nil<int_>());
+
+    BOOST_TEST(drop(2_d, list<int_>{1, 2, 3}) == list<int_>{3});
+    BOOST_TEST(drop(5_d, list<int_>{1, 2}) == nil<int_>());
+    BOOST_TEST(drop(-1_d, list<int_>{1, 2}) == (list<int_>{1, 2}));
+
+    BOOST_TEST(
+        take_while(EASYLAZY_FUNCTION(int_ x) { return x < 3_d; }, list<int_>{1, 2, 3, 1})
+            == (list<int_>{1, 2})
+    );
+
+    BOOST_TEST(
+        zip_with(EASYLAZY_FUNCTION(int_ x, int_ y) { return x * y; }, list<int_>{1, 2, 3}, list<int_>{4, 5})
+            == (list<int_>{4, 10})
+    );
+    BOOST_TEST(
+        zip_with_s(EASYLAZY_FUNCTION(int_ x, int_ y) { return x - y; }, list<int_>{1, 2}, list<int_>{4, 5, 6})
+            == (list<int_>{-3, -3})
+    );
+
+    auto z = zip(list<int_>{1, 2}, "ab"_s);
+    BOOST_TEST(length(z) == 2_d);
+    BOOST_TEST(std::get<0>(z[1_d].get()) == 2_d);
+    BOOST_TEST(std::get<1>(z[1_d].get()) == 'b'_c);
+
+    BOOST_TEST(take(3_d, repeat(7_d)) == (list<int_>{7, 7, 7}));
+
+    BOOST_TEST(
+        take(4_d, iterate(EASYLAZY_FUNCTION(int_ x) { return x * 2_d; }, 1_d))
+            == (list<int_>{1, 2, 4, 8})
+    );
+    BOOST_TEST(iterate_s(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d)[10000_d] == 10000_d);
+
+    using step = thunk<std::optional<std::tuple<int_, int_>>>;
+    BOOST_TEST(
+        unfoldr(
+            EASYLAZY_FUNCTION(int_ n) {
+                return step([=]() {
+                    return n > 0_d ? step(std::make_tuple(n, n - 1_d)) : step(std::nullopt);
+                });
+            },
+            3_d
+        ) == (list<int_>{3, 2, 1})
+    );
+
+    BOOST_TEST(
+        scanl(EASYLAZY_FUNCTION(int_ x, int_ y) { return x + y; }, 0_d, list<int_>{1, 2, 3})
+            == (list<int_>{0, 1, 3, 6})
+    );
+    BOOST_TEST(
+        scanl(EASYLAZY_FUNCTION(int_ x, int_ y) { return x + y; }, 0_d, nil<int_>())
+            == list<int_>{0}
+    );
+    BOOST_TEST(
+        scanl_s(EASYLAZY_FUNCTION(int_ x, int_ y) { return x + y; }, 0_d, repeat(1_d))[10000_d]
+            == 10000_d
+    );
+
+    BOOST_TEST(insert(3_d, list<int_>{1, 2, 4}) == (list<int_>{1, 2, 3, 4}));
+    BOOST_TEST(insert(5_d, list<int_>{1, 2, 4}) == (list<int_>{1, 2, 4, 5}));
+    BOOST_TEST(merge(list<int_>{1, 3, 5}, list<int_>{2, 3, 4}) == (list<int_>{1, 2, 3, 3, 4, 5}));
+    BOOST_TEST(
+        merge_all(list<list<int_>>{list<int_>{1, 4, 7}, nil<int_>(), list<int_>{2, 5}, list<int_>{0, 3, 6, 9}})
+            == (list<int_>{0, 1, 2, 3, 4, 5, 6, 7, 9})
+    );
+    BOOST_TEST(null(merge_all(nil<list<int_>>())));
+    BOOST_TEST(
+        take(6_d, merge_all(list<list<int_>>{
+            iterate(EASYLAZY_FUNCTION(int_ x) { return x + 3_d; }, 0_d),
+            iterate(EASYLAZY_FUNCTION(int_ x) { return x + 3_d; }, 1_d),
+            iterate(EASYLAZY_FUNCTION(int_ x) { return x + 3_d; }, 2_d)
+        })) == (list<int_>{0, 1, 2, 3, 4, 5})
+    );
+    BOOST_TEST(sort(list<int_>{5, 3, 9, 1, 1, 8}) == (list<int_>{1, 1, 3, 5, 8, 9}));
+    BOOST_TEST(null(sort(nil<int_>())));
+
+    {
+        // Equal elements keep their order.
+        list<item_> merged = merge_all(list<list<item_>>{
+            list<item_>{item_(item{1, 0}), item_(item{2, 0})},
+            list<item_>{item_(item{1, 1}), item_(item{2, 1})}
+        });
+        BOOST_TEST(merged[1_d].get().tag == 1 && merged[2_d].get().tag == 0);
+
+        // An element is inserted before the equal ones.
+        list<item_> inserted = insert(
+            item_(item{1, 1}),
+            list<item_>{item_(item{0, 0}), item_(item{1, 0}), item_(item{2, 0})}
+        );
+        BOOST_TEST(inserted[1_d].get().tag == 1 && inserted[2_d].get().tag == 0);
+        BOOST_TEST(inserted[3_d].get().key == 2);
+
+        std::vector<item_> v;
+        for (int i = 0; i < 1024; ++i) {
+            v.push_back(item_(item{(i * 37) % 1024, i}));
+        }
+        comparisons = 0;
+        list<item_> sorted = sort(list<item_>(v));
+        BOOST_TEST(head(sorted).get().key == 0);
+        BOOST_TEST(comparisons == 1023);
+        comparisons = 0;
+        BOOST_TEST(sorted[10_d].get().key == 10);
+        BOOST_TEST(comparisons <= 100);
+    }
+
+    {
+        // A failed step leaves the merge to be resumed.
+        bool fail = true;
+        list<int_> flaky = cons(1_d, list<int_>([&]() {
+            if (fail) {
+                fail = false;
+                throw std::runtime_error("flaky");
+            }
+            return list<int_>{3, 5};
+        }));
+        list<int_> merged = merge_all(list<list<int_>>{flaky, list<int_>{2, 4}});
+        BOOST_TEST(merged[0_d] == 1_d);
+        BOOST_TEST_THROWS(merged[1_d].get(), std::runtime_error);
+        BOOST_TEST(merged == (list<int_>{1, 2, 3, 4, 5}));
+    }
+
     return boost::report_errors();
 }
@@ -0,0 +1,88 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <vector>
+#include <boost/core/lightweight_test.hpp>
+#define EASYLAZY_ENABLE_INTEGER
+#define EASYLAZY_ENABLE_PERSISTENCE
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+int main() {
+    char const *path = "easylazy_persistent_test.cache";
+    std::remove(path);
+
+    int count = 0;
+    auto counted = [&](auto x) {
+        return decltype(x)([&count, x]() {
+            ++count;
+            return x;
+        });
+    };
+
+    // The length of a list of 0, 1, 2, ..., or -1 for another list.
+    auto walk = [](list_rep<int_> rep) {
+        int n = 0;
+        for (; rep.index() != 0; ++n) {
+            auto [x, xs] = std::get<1>(rep);
+            if (x.get() != n) {
+                return -1;
+            }
+            rep = xs.get();
+        }
+        return n;
+    };
+
+    {
+        persistent_cache cache(path, 1);
+        BOOST_TEST(cache.memoize("n", counted(42_d)).get() == 42);
+        BOOST_TEST(cache.memoize("x", counted(2.5_lf)).get() == 2.5);
+        BOOST_TEST(cache.memoize("big", counted(integer(-1) << 200_d)).get() == -(integer::type(1) << 200));
+        BOOST_TEST(cache.memoize("xs", counted(list<int_>{1, 2, 3})).get_as<std::vector<int>>() == (std::vector<int>{1, 2, 3}));
+        BOOST_TEST(count == 4);
+        BOOST_TEST(walk(cache.memoize("long", take(200000_d, iterate_s(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d))).get()) == 200000);
+
+        // Only the resolved part of a list is saved.
+        auto nats = cache.memoize("nats", iterate(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 0_d));
+        BOOST_TEST(head(nats) == 0_d);
+        BOOST_TEST(nats[2_d] == 2_d);
+        cache.save();
+    }
+
+    count = 0;
+    {
+        persistent_cache cache(path, 1);
+        BOOST_TEST(cache.memoize("n", counted(0_d)).get() == 42);
+        BOOST_TEST(cache.memoize("x", counted(0.0_lf)).get() == 2.5);
+        BOOST_TEST(cache.memoize("big", counted(0_n)).get() == -(integer::type(1) << 200));
+        BOOST_TEST(cache.memoize("xs", counted(nil<int_>())).get_as<std::vector<int>>() == (std::vector<int>{1, 2, 3}));
+        BOOST_TEST(count == 0);
+
+        BOOST_TEST(walk(cache.memoize("long", nil<int_>()).get()) == 200000);
+
+        // The rest is computed again.
+        auto nats = cache.memoize("nats", iterate(EASYLAZY_FUNCTION(int_ x) { return x + 1_d; }, 100_d));
+        BOOST_TEST((take(5_d, nats) == list<int_>{0_d, 1_d, 2_d, 103_d, 104_d}));
+
+        // An entry of another type is recomputed.
+        BOOST_TEST(cache.memoize("n", counted(1.5_f)).get() == 1.5f);
+        BOOST_TEST(count == 1);
+    }
+
+    count = 0;
+    {
+        persistent_cache cache(path, 2);
+        BOOST_TEST(cache.memoize("n", counted(7_d)).get() == 7);
+        BOOST_TEST(count == 1);
+    }
+
+    std::remove(path);
+
+    return boost::report_errors();
+}
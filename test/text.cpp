@@ -0,0 +1,60 @@
+// easylazy
+//
+// Copyright iorate 2019.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <boost/core/lightweight_test.hpp>
+#include "../easylazy.hpp"
+
+using namespace easylazy;
+
+int main() {
+    BOOST_TEST("hello"_t .get_as<std::string>() == "hello");
+    BOOST_TEST(text(std::string()).get_as<std::string>() == "");
+
+    BOOST_TEST(unpack("hello"_t) == "hello"_s);
+    BOOST_TEST(pack("hello"_s) == "hello"_t);
+    BOOST_TEST(pack(nil<char_>()) == ""_t);
+
+    // Texts made of differently sized chunks.
+    std::string long_str(1000, 'a');
+    long_str += "needle";
+    long_str += std::string(1000, 'b');
+    text t1(long_str);
+    text t2 = pack(string(long_str));
+    BOOST_TEST(t1 == t2);
+    BOOST_TEST(t2.get_as<std::string>() == long_str);
+
+    BOOST_TEST(("abc"_t < "abd"_t).get() == true);
+    BOOST_TEST(("abc"_t < "ab"_t).get() == false);
+    BOOST_TEST((""_t < "a"_t).get() == true);
+    BOOST_TEST(("a"_t < "a"_t).get() == false);
+    BOOST_TEST(("a"_t < "\xff"_t).get() == true);
+    BOOST_TEST(("abc"_t >= "abc"_t).get() == true);
+    BOOST_TEST(("abc"_t != "abcd"_t).get() == true);
+    BOOST_TEST((pack(string(long_str + "c")) > t1).get() == true);
+    BOOST_TEST((pack(string(std::string(1000, 'a') + "z")) > t1).get() == true);
+
+    BOOST_TEST(find("needle"_t, t1) == 1000_d);
+    BOOST_TEST(find("needle"_t, t2) == 1000_d);
+    BOOST_TEST(find("an"_t, t2) == 999_d);
+    BOOST_TEST(find("bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"_t, t2) == 1006_d);
+    BOOST_TEST(find("nodle"_t, t2) == -1_d);
+    BOOST_TEST(find(""_t, t2) == 0_d);
+    BOOST_TEST(find("a"_t, ""_t) == -1_d);
+
+    BOOST_TEST(split(','_c, "a,b,,c"_t) == (list<text>{"a"_t, "b"_t, ""_t, "c"_t}));
+    BOOST_TEST(split(','_c, "a,"_t) == (list<text>{"a"_t, ""_t}));
+    BOOST_TEST(split(','_c, ""_t) == list<text>{""_t});
+    BOOST_TEST(split('e'_c, t2) == (list<text>{text(std::string(1000, 'a') + "n"), ""_t, "dl"_t, text(std::string(1000, 'b'))}));
+
+    BOOST_TEST(lines("a\nbc\n"_t) == (list<text>{"a"_t, "bc"_t}));
+    BOOST_TEST(lines("a\n\nb"_t) == (list<text>{"a"_t, ""_t, "b"_t}));
+    BOOST_TEST(lines("\n"_t) == list<text>{""_t});
+    BOOST_TEST(null(lines(""_t)));
+
+    return boost::report_errors();
+}